@@ -0,0 +1,136 @@
+#include "assets.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+
+// The piece images are linked into the binary by the makefile
+// (ld -r -b binary), which names the symbols after the file path
+#define EMBEDDED_IMAGE(name)                                                   \
+    extern const unsigned char _binary_images_##name##_png_start[];            \
+    extern const unsigned char _binary_images_##name##_png_end[];
+
+#define IMAGE_ENTRY(symbol, name)                                              \
+    {symbol, _binary_images_##name##_png_start,                                \
+     _binary_images_##name##_png_end}
+
+EMBEDDED_IMAGE(pawn_w)
+EMBEDDED_IMAGE(pawn_b)
+EMBEDDED_IMAGE(rook_w)
+EMBEDDED_IMAGE(rook_b)
+EMBEDDED_IMAGE(knight_w)
+EMBEDDED_IMAGE(knight_b)
+EMBEDDED_IMAGE(bishop_w)
+EMBEDDED_IMAGE(bishop_b)
+EMBEDDED_IMAGE(queen_w)
+EMBEDDED_IMAGE(queen_b)
+EMBEDDED_IMAGE(king_w)
+EMBEDDED_IMAGE(king_b)
+
+typedef struct {
+    char symbol;
+    const unsigned char *start;
+    const unsigned char *end;
+} EmbeddedImage;
+
+// Same order as the pieces array, the index is the atlas cell
+static const EmbeddedImage images[PIECE_IMAGE_COUNT] = {
+    IMAGE_ENTRY('P', pawn_w),   IMAGE_ENTRY('p', pawn_b),
+    IMAGE_ENTRY('R', rook_w),   IMAGE_ENTRY('r', rook_b),
+    IMAGE_ENTRY('N', knight_w), IMAGE_ENTRY('n', knight_b),
+    IMAGE_ENTRY('B', bishop_w), IMAGE_ENTRY('b', bishop_b),
+    IMAGE_ENTRY('Q', queen_w),  IMAGE_ENTRY('q', queen_b),
+    IMAGE_ENTRY('K', king_w),   IMAGE_ENTRY('k', king_b),
+};
+
+static SDL_Thread *loader_thread = NULL;
+static SDL_Surface *atlas_surface = NULL;
+static double decode_ms = 0.0;
+
+static int load_atlas(void *data)
+{
+    (void) data;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    atlas_surface = SDL_CreateRGBSurfaceWithFormat(
+        0, ATLAS_WIDTH, ATLAS_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!atlas_surface) {
+        printf("Failed to create atlas: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Rect solid = get_solid_atlas_rect();
+    SDL_FillRect(atlas_surface, &solid, 0xFFFFFFFF);
+
+    for (int i = 0; i < PIECE_IMAGE_COUNT; i++) {
+        SDL_RWops *rw = SDL_RWFromConstMem(
+            images[i].start, (int) (images[i].end - images[i].start));
+        SDL_Surface *surface = IMG_Load_RW(rw, 1);
+        if (!surface) {
+            printf("Failed to decode image '%c': %s\n", images[i].symbol,
+                   IMG_GetError());
+            continue;
+        }
+        // Copy the pixels as they are, blending onto the empty atlas would
+        // darken the anti-aliased edges
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_Rect cell = get_piece_atlas_rect(images[i].symbol);
+        SDL_BlitSurface(surface, NULL, atlas_surface, &cell);
+        SDL_FreeSurface(surface);
+    }
+
+    decode_ms = (double) (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                (double) SDL_GetPerformanceFrequency();
+    return 0;
+}
+
+int start_asset_loader(void)
+{
+    loader_thread = SDL_CreateThread(load_atlas, "asset_loader", NULL);
+    if (!loader_thread) {
+        printf("Failed to start asset loader: %s\n", SDL_GetError());
+        return 1;
+    }
+    return 0;
+}
+
+SDL_Texture *finish_asset_loader(SDL_Renderer *renderer)
+{
+    // Textures can only be created on the render thread, so the loader only
+    // decodes and the upload happens here
+    int status = 1;
+    SDL_WaitThread(loader_thread, &status);
+    loader_thread = NULL;
+    if (status != 0 || !atlas_surface) {
+        return NULL;
+    }
+
+    SDL_Texture *atlas = SDL_CreateTextureFromSurface(renderer, atlas_surface);
+    if (!atlas) {
+        printf("Failed to upload atlas: %s\n", SDL_GetError());
+    }
+    SDL_FreeSurface(atlas_surface);
+    atlas_surface = NULL;
+    return atlas;
+}
+
+SDL_Rect get_piece_atlas_rect(char symbol)
+{
+    for (int i = 0; i < PIECE_IMAGE_COUNT; i++) {
+        if (images[i].symbol == symbol) {
+            return (SDL_Rect) {i * PIECE_IMAGE_SIZE, 0, PIECE_IMAGE_SIZE,
+                               PIECE_IMAGE_SIZE};
+        }
+    }
+    return (SDL_Rect) {0, 0, 0, 0};
+}
+
+SDL_Rect get_solid_atlas_rect(void)
+{
+    return (SDL_Rect) {PIECE_IMAGE_COUNT * PIECE_IMAGE_SIZE, 0,
+                       PIECE_IMAGE_SIZE, PIECE_IMAGE_SIZE};
+}
+
+double get_asset_decode_ms(void)
+{
+    return decode_ms;
+}
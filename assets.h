@@ -0,0 +1,22 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#define PIECE_IMAGE_SIZE 60
+#define PIECE_IMAGE_COUNT 12
+// One extra white cell for untextured (solid colour) geometry
+#define ATLAS_WIDTH (PIECE_IMAGE_SIZE * (PIECE_IMAGE_COUNT + 1))
+#define ATLAS_HEIGHT PIECE_IMAGE_SIZE
+
+#include <SDL2/SDL.h>
+
+int start_asset_loader(void);
+
+SDL_Texture *finish_asset_loader(SDL_Renderer *renderer);
+
+SDL_Rect get_piece_atlas_rect(char symbol);
+
+SDL_Rect get_solid_atlas_rect(void);
+
+double get_asset_decode_ms(void);
+
+#endif
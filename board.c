@@ -1,14 +1,18 @@
 #include "board.h"
 
+#include "kpk.h"
 #include "pieces.h"
 
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define KPK_WIN_SCORE 900
+
+// Indexed by Promotion
+static const char promotion_symbols[5] = {'\0', 'n', 'b', 'r', 'q'};
+
 int count_bits(uint64_t number)
 {
     int count = 0;
@@ -19,32 +23,87 @@ int count_bits(uint64_t number)
     return count;
 }
 
-int calculate_total_piece_value(Piece pieces[], char color)
+int calculate_total_piece_value(const Position *pos, char color)
 {
+    const Piece *pieces = get_pieces();
     int total_value = 0;
     for (int i = 0; i < 12; i++) {
         if (pieces[i].color == color) {
-            Piece piece = pieces[i];
-            int amount_bits_set = count_bits(*piece.pos_bb);
-            total_value = total_value + (amount_bits_set * piece.value);
+            int amount_bits_set = count_bits(pos->bitboards[i]);
+            total_value = total_value + (amount_bits_set * pieces[i].value);
         }
     }
     return total_value;
 }
 
-char color_to_move(GameState *game_state)
+// King and pawn against king is looked up instead of evaluated. A win is
+// scored like the queen it becomes, more the further the pawn has come.
+static int evaluate_kpk(const Position *pos)
+{
+    uint64_t pawns = pos->bitboards[get_piece_index('P')] |
+                     pos->bitboards[get_piece_index('p')];
+    char strong_color = pos->bitboards[get_piece_index('P')] ? 'w' : 'b';
+    int pawn = get_lowest_bit_index(pawns);
+    int white_king = get_lowest_bit_index(pos->bitboards[get_piece_index('K')]);
+    int black_king = get_lowest_bit_index(pos->bitboards[get_piece_index('k')]);
+    int strong_king = strong_color == 'w' ? white_king : black_king;
+    int weak_king = strong_color == 'w' ? black_king : white_king;
+
+    if (!probe_kpk(strong_color, strong_king, pawn, weak_king,
+                   pos->side_to_move)) {
+        return 0;
+    }
+    int pawn_rows = strong_color == 'w' ? pawn / 8 : 7 - pawn / 8;
+    int score = KPK_WIN_SCORE + pawn_rows * 10;
+    return strong_color == pos->side_to_move ? score : -score;
+}
+
+int evaluate(const Position *pos)
+{
+    uint64_t pawns = pos->bitboards[get_piece_index('P')] |
+                     pos->bitboards[get_piece_index('p')];
+    // A pawn on the first or last row is not a real position, skip it
+    if (count_bits(get_full_board(pos)) == 3 && count_bits(pawns) == 1 &&
+        !(pawns & 0xFF000000000000FFULL)) {
+        return evaluate_kpk(pos);
+    }
+
+    // Material only, in centipawns from the side to move
+    int score = (calculate_total_piece_value(pos, 'w') -
+                 calculate_total_piece_value(pos, 'b')) *
+                100;
+    return pos->side_to_move == 'w' ? score : -score;
+}
+
+char color_to_move(const Position *pos)
+{
+    return pos->side_to_move;
+}
+
+void move_to_notation(Move move, char notation[6])
 {
-    return game_state->total_moves % 2 == 0 ? 'w' : 'b';
+    Square from = square_from_position(get_move_from(move));
+    Square to = square_from_position(get_move_to(move));
+    notation[0] = FILE_OFFSET + from.file;
+    notation[1] = ROW_OFFSET + from.row;
+    notation[2] = FILE_OFFSET + to.file;
+    notation[3] = ROW_OFFSET + to.row;
+    // Promotion values past the table can come from outside, leave them off
+    int promotion = get_move_promotion(move);
+    notation[4] = promotion <= PROMOTE_QUEEN ? promotion_symbols[promotion]
+                                             : '\0';
+    notation[5] = '\0';
 }
 
-void squares_to_notation(Square input_square, Square output_square,
-                         char last_move[5])
+int promotion_from_symbol(char symbol)
 {
-    last_move[0] = FILE_OFFSET + input_square.file;
-    last_move[1] = ROW_OFFSET + input_square.row;
-    last_move[2] = FILE_OFFSET + output_square.file;
-    last_move[3] = ROW_OFFSET + output_square.row;
-    last_move[4] = '\0';
+    for (int i = PROMOTE_KNIGHT; i <= PROMOTE_QUEEN; i++) {
+        if (promotion_symbols[i] == symbol ||
+            promotion_symbols[i] - ('a' - 'A') == symbol) {
+            return i;
+        }
+    }
+    return NO_PROMOTION;
 }
 
 void print_bitboard(uint64_t possible_moves)
@@ -105,733 +164,622 @@ void unset_bit(uint64_t *piece_bb, int position)
     *piece_bb &= ~mask;
 }
 
-int is_check(Piece pieces[], GameState *game_state, char color_moving)
+int is_check(const Position *pos, char color_moving)
 {
     int king_index = color_moving == 'b' ? WHITE_KING_INDEX : BLACK_KING_INDEX;
-    TeamState *team_state =
-        color_moving == 'b' ? game_state->white_state : game_state->black_state;
-    int king_position = get_lowest_bit_index(*(pieces[king_index].pos_bb));
-
-    int default_king_position =
-        color_moving == 'b' ? WHITE_KING_POSITION : BLACK_KING_POSITION;
-    int castle_directions[4] = {-2, -1, 1, 2};
-
-    int short_castle_allowed = 1;
-    int long_castle_allowed = 1;
-    int is_check = 0;
-
-    for (int i = 0; i < 12; i++) {
-        if (pieces[i].color == color_moving) {
-            uint64_t piece_bb = *(pieces[i].pos_bb);
-            while (piece_bb) {
-                int position = get_lowest_bit_index(piece_bb);
-                Square input_square = square_from_position(position);
-                Piece *piece = find_piece_by_position(position);
-
-                if (piece != NULL) {
-                    uint64_t pos_mov =
-                        find_possible_moves(input_square, piece, game_state);
-                    if (is_bit_set(pos_mov, king_position) && !(is_check)) {
-                        is_check = 1;
-                    }
-                    for (int i = 0; i < 4; i++) {
-                        int direction = castle_directions[i];
-                        if (is_bit_set(pos_mov,
-                                       default_king_position + direction)) {
-                            if (direction > 0) {
-                                short_castle_allowed = 0;
-                            } else {
-                                long_castle_allowed = 0;
-                            }
-                        }
-                    }
-                }
-                piece_bb &= piece_bb - 1;
-            }
-        }
-    }
-    team_state->long_castle_allowed = long_castle_allowed;
-    team_state->short_castle_allowed = short_castle_allowed;
+    int king_position = get_lowest_bit_index(pos->bitboards[king_index]);
 
-    return is_check;
+    return is_bit_set(find_attacked_squares(pos, color_moving), king_position);
 }
 
-int get_rook_castle_position(char color_moving, char castle_type)
+int get_promoted_piece_index(char color, int promotion)
 {
-    switch (color_moving) {
-    case 'b':
-        switch (castle_type) {
-        case 's':
-            return BLACK_SHORT_ROOK_POSITION;
-            break;
-        case 'l':
-            return BLACK_LONG_ROOK_POSITION;
-            break;
-        }
-    case 'w':
-        switch (castle_type) {
-        case 's':
-            return WHITE_SHORT_ROOK_POSITION;
-            break;
-        case 'l':
-            return WHITE_LONG_ROOK_POSITION;
-            break;
-        }
-    default:
-        return -1;
-        break;
+    char symbol = promotion_symbols[promotion];
+    if (color == 'w') {
+        symbol -= 'a' - 'A';
     }
+    return get_piece_index(symbol);
 }
 
-void make_move(Square input_square, Square output_square, Piece pieces[],
-               GameState *game_state, int update_state, int real_move)
+void make_move(Position *pos, Move move, MoveUndo *undo)
 {
-    int old_pos = get_position(input_square.file, input_square.row);
-    Piece *piece = find_piece_by_position(old_pos);
-    char color_moving = piece->color;
-    int new_pos = get_position(output_square.file, output_square.row);
-    int castle_move = 0;
-    TeamState *team_state =
-        color_moving == 'w' ? game_state->white_state : game_state->black_state;
-
-    if (piece->symbol == 'k' || piece->symbol == 'K') {
-        int short_castle = color_moving == 'w' ? WHITE_SHORT_CASTLE_POSITION
-                                               : BLACK_SHORT_CASTLE_POSITION;
-        int long_castle = color_moving == 'w' ? WHITE_LONG_CASTLE_POSITION
-                                              : BLACK_LONG_CASTLE_POSITION;
-
-        if ((team_state->long_castle_allowed && new_pos == long_castle) ||
-            (team_state->short_castle_allowed && new_pos == short_castle)) {
-            castle_move = 1;
-            char castle_type = new_pos == long_castle ? 'l' : 's';
-            int rook_index =
-                get_rook_castle_position(color_moving, castle_type);
-            int direction = castle_type == 'l' ? 1 : -1;
-
-            Piece *rook = find_piece_by_position(rook_index);
-            unset_bit(rook->pos_bb, rook_index);
-            set_bit(rook->pos_bb, new_pos + direction);
-
-            unset_bit(piece->pos_bb, old_pos);
-            set_bit(piece->pos_bb, new_pos);
-
-            team_state->short_castle_allowed = 0;
-            team_state->long_castle_allowed = 0;
-        }
-    }
-    if (!(castle_move)) {
-        Piece *other_piece = find_piece_by_position(new_pos);
-
-        if (game_state->play_en_passant) {
-            int other_pawn_pos = new_pos;
-            if (color_moving == 'w') {
-                other_pawn_pos = other_pawn_pos - 8;
-            } else {
-                other_pawn_pos = other_pawn_pos + 8;
-            }
-            other_piece = find_piece_by_position(other_pawn_pos);
+    const Piece *pieces = get_pieces();
+    int old_pos = get_move_from(move);
+    int new_pos = get_move_to(move);
+    int promotion = get_move_promotion(move);
+    int moved_piece = find_piece_by_position(pos, old_pos);
+    char color_moving = pieces[moved_piece].color;
+    char symbol = pieces[moved_piece].symbol;
+    int is_pawn = symbol == 'P' || symbol == 'p';
+
+    undo->move = move;
+    undo->moved_piece = moved_piece;
+    undo->captured_piece = -1;
+    undo->capture_square = NO_SQUARE;
+    undo->castle_right = -1;
+    undo->castle_rights = pos->castle_rights;
+    undo->en_passant = pos->en_passant;
+    undo->halfmove_clock = pos->halfmove_clock;
+
+    pos->en_passant = NO_SQUARE;
+    pos->halfmove_clock++;
+
+    if (symbol == 'k' || symbol == 'K') {
+        undo->castle_right =
+            find_castle_right(pos, color_moving, old_pos, new_pos);
+    }
+    if (undo->castle_right >= 0) {
+        const CastleRule *rule = &pos->castle_rules[undo->castle_right];
+        int rook_index =
+            color_moving == 'w' ? WHITE_ROOK_INDEX : BLACK_ROOK_INDEX;
 
-            if (!(other_piece == NULL)) {
-                unset_bit(other_piece->pos_bb, other_pawn_pos);
-                if (!(update_state)) {
-                    game_state->last_captured_piece = other_piece->symbol;
-                }
-            }
-            unset_bit(piece->pos_bb, old_pos);
-            set_bit(piece->pos_bb, new_pos);
-        } else {
-            if (!(other_piece == NULL)) {
-                unset_bit(other_piece->pos_bb, new_pos);
-                if (!(update_state)) {
-                    game_state->last_captured_piece = other_piece->symbol;
-                }
-            }
+        // Lift both pieces first, in Chess960 their squares can overlap
+        unset_bit(&pos->bitboards[rook_index], rule->rook_from);
+        unset_bit(&pos->bitboards[moved_piece], old_pos);
 
-            unset_bit(piece->pos_bb, old_pos);
-            if (game_state->promote_pawn) {
-                piece = get_piece_bb(game_state->promote_to);
-            }
-            set_bit(piece->pos_bb, new_pos);
+        set_bit(&pos->bitboards[rook_index], rule->rook_to);
+        set_bit(&pos->bitboards[moved_piece], rule->king_to);
+    } else {
+        int capture_square = new_pos;
+        if (is_pawn && new_pos == undo->en_passant &&
+            new_pos % 8 != old_pos % 8) {
+            // The pawn taken en passant sits behind the destination
+            capture_square = color_moving == 'w' ? new_pos - 8 : new_pos + 8;
+        }
+        int captured_piece = find_piece_by_position(pos, capture_square);
+        if (captured_piece >= 0) {
+            unset_bit(&pos->bitboards[captured_piece], capture_square);
+            undo->captured_piece = captured_piece;
+            undo->capture_square = capture_square;
         }
-    }
 
-    if (real_move) {
-        char rook_symbol = color_moving == 'w' ? 'R' : 'r';
-        int short_castle = color_moving == 'w' ? WHITE_SHORT_ROOK_POSITION
-                                               : BLACK_SHORT_ROOK_POSITION;
-        int long_castle = color_moving == 'w' ? WHITE_LONG_ROOK_POSITION
-                                              : BLACK_LONG_ROOK_POSITION;
-        if ((piece->symbol == rook_symbol) &&
-            (old_pos == short_castle || old_pos == long_castle)) {
-            if (team_state->long_castle_allowed && old_pos == long_castle) {
-                team_state->long_castle_allowed = 0;
-            }
-            if (team_state->short_castle_allowed && old_pos == short_castle) {
-                team_state->short_castle_allowed = 0;
-            }
+        unset_bit(&pos->bitboards[moved_piece], old_pos);
+        int placed_piece = moved_piece;
+        if (promotion != NO_PROMOTION) {
+            placed_piece = get_promoted_piece_index(color_moving, promotion);
         }
+        set_bit(&pos->bitboards[placed_piece], new_pos);
 
-        if ((piece->symbol == 'k' || piece->symbol == 'K')) {
-            team_state->long_castle_allowed = 0;
-            team_state->short_castle_allowed = 0;
+        if (is_pawn && abs(new_pos - old_pos) == 16) {
+            pos->en_passant = (old_pos + new_pos) / 2;
+        }
+        if (is_pawn || captured_piece >= 0) {
+            pos->halfmove_clock = 0;
         }
     }
 
-    if (update_state) {
-        game_state->promote_pawn = 0;
-        game_state->promote_to = '0';
-        game_state->play_en_passant = 0;
-        game_state->last_moved_piece = piece->symbol;
-        game_state->is_check = is_check(pieces, game_state, color_moving);
-        game_state->total_moves++;
+    pos->castle_rights =
+        update_castle_rights(pos, pos->castle_rights, old_pos, new_pos);
+    if (color_moving == 'b') {
+        pos->fullmove_number++;
     }
+    pos->side_to_move = color_moving == 'w' ? 'b' : 'w';
 }
 
-const char *get_image_path(char symbol)
+void unmake_move(Position *pos, const MoveUndo *undo)
 {
-    switch (symbol) {
-    case 'P':
-        return "images/pawn_w.png";
-    case 'p':
-        return "images/pawn_b.png";
-    case 'R':
-        return "images/rook_w.png";
-    case 'r':
-        return "images/rook_b.png";
-    case 'N':
-        return "images/knight_w.png";
-    case 'n':
-        return "images/knight_b.png";
-    case 'B':
-        return "images/bishop_w.png";
-    case 'b':
-        return "images/bishop_b.png";
-    case 'Q':
-        return "images/queen_w.png";
-    case 'q':
-        return "images/queen_b.png";
-    case 'K':
-        return "images/king_w.png";
-    case 'k':
-        return "images/king_b.png";
-    default:
-        return NULL;
+    const Piece *pieces = get_pieces();
+    int old_pos = get_move_from(undo->move);
+    int new_pos = get_move_to(undo->move);
+    int promotion = get_move_promotion(undo->move);
+    char color_moving = pieces[undo->moved_piece].color;
+
+    if (undo->castle_right >= 0) {
+        const CastleRule *rule = &pos->castle_rules[undo->castle_right];
+        int rook_index =
+            color_moving == 'w' ? WHITE_ROOK_INDEX : BLACK_ROOK_INDEX;
+
+        unset_bit(&pos->bitboards[rook_index], rule->rook_to);
+        unset_bit(&pos->bitboards[undo->moved_piece], rule->king_to);
+
+        set_bit(&pos->bitboards[rook_index], rule->rook_from);
+        set_bit(&pos->bitboards[undo->moved_piece], old_pos);
+    } else {
+        int placed_piece = undo->moved_piece;
+        if (promotion != NO_PROMOTION) {
+            placed_piece = get_promoted_piece_index(color_moving, promotion);
+        }
+        unset_bit(&pos->bitboards[placed_piece], new_pos);
+        set_bit(&pos->bitboards[undo->moved_piece], old_pos);
+
+        if (undo->captured_piece >= 0) {
+            set_bit(&pos->bitboards[undo->captured_piece],
+                    undo->capture_square);
+        }
+    }
+
+    pos->castle_rights = undo->castle_rights;
+    pos->en_passant = undo->en_passant;
+    pos->halfmove_clock = undo->halfmove_clock;
+    if (color_moving == 'b') {
+        pos->fullmove_number--;
     }
+    pos->side_to_move = color_moving;
 }
 
-void draw_possible_moves(SDL_Renderer *renderer, char board[8][8],
-                         uint64_t pos_mov)
+void validate_possible_moves(Position *pos, uint64_t *pos_mov,
+                             Square input_square)
 {
-    for (int rank = 7; rank >= 0; rank--) {
-        for (int file = 0; file < 8; file++) {
-            int sq = rank * 8 + file;
-            uint64_t mask = (uint64_t) 1 << sq;
-            if (pos_mov & mask) {
-                // Enable alpha blending
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-
-                // Set semi-transparent dark army green color (R, G, B, Alpha)
-                SDL_SetRenderDrawColor(renderer, 60, 80, 50, 180);
-
-                // Check if square has a piece (capture move)
-                if (board[rank][file] != 0) {
-                    // Draw triangles in corners
-                    int corner_size = SQUARE_SIZE / 5;
-                    int x = file * SQUARE_SIZE;
-                    int y = (7 - rank) * SQUARE_SIZE;
-
-                    // Top-left triangle (corner at top-left, legs going right
-                    // and down)
-                    for (int i = 0; i < corner_size; i++) {
-                        for (int j = 0; j < corner_size - i; j++) {
-                            SDL_RenderDrawPoint(renderer, x + j, y + i);
-                        }
-                    }
-
-                    // Top-right triangle (corner at top-right, legs going left
-                    // and down)
-                    for (int i = 0; i < corner_size; i++) {
-                        for (int j = 0; j < corner_size - i; j++) {
-                            SDL_RenderDrawPoint(renderer,
-                                                x + SQUARE_SIZE - 1 - j, y + i);
-                        }
-                    }
+    // This could be done by checking which piece attacks the king -> calculate
+    // which squares need to be blocked in order to fix check. Or take piece
+    // that sets king in check In case of double check always move the king
+    uint64_t copy_pos_mov = *pos_mov;
+    int input_position = get_position(input_square.file, input_square.row);
+    int piece_index = find_piece_by_position(pos, input_position);
+    if (piece_index < 0) {
+        *pos_mov = (uint64_t) 0;
+        return;
+    }
+    char color = get_pieces()[piece_index].color;
+    char color_moving = color == 'w' ? 'b' : 'w';
 
-                    // Bottom-left triangle (corner at bottom-left, legs going
-                    // right and up)
-                    for (int i = 0; i < corner_size; i++) {
-                        for (int j = 0; j < corner_size - i; j++) {
-                            SDL_RenderDrawPoint(renderer, x + j,
-                                                y + SQUARE_SIZE - 1 - i);
-                        }
-                    }
+    while (copy_pos_mov) {
+        int next_position = get_lowest_bit_index(copy_pos_mov);
+        copy_pos_mov &= copy_pos_mov - 1;
 
-                    // Bottom-right triangle (corner at bottom-right, legs going
-                    // left and up)
-                    for (int i = 0; i < corner_size; i++) {
-                        for (int j = 0; j < corner_size - i; j++) {
-                            SDL_RenderDrawPoint(renderer,
-                                                x + SQUARE_SIZE - 1 - j,
-                                                y + SQUARE_SIZE - 1 - i);
-                        }
-                    }
-                } else {
-                    // Draw circle in center for empty squares
-                    int center_x = file * SQUARE_SIZE + SQUARE_SIZE / 2;
-                    int center_y = (7 - rank) * SQUARE_SIZE + SQUARE_SIZE / 2;
-                    int radius = SQUARE_SIZE / 6;
-
-                    for (int w = 0; w < radius * 2; w++) {
-                        for (int h = 0; h < radius * 2; h++) {
-                            int dx = radius - w;
-                            int dy = radius - h;
-                            if ((dx * dx + dy * dy) <= (radius * radius)) {
-                                SDL_RenderDrawPoint(renderer, center_x + dx,
-                                                    center_y + dy);
-                            }
-                        }
-                    }
-                }
-            }
+        // Castling legality is fully decided by the castle rule masks
+        if (find_castle_right(pos, color, input_position, next_position) >=
+            0) {
+            continue;
         }
+        // The promotion piece cannot change whether the king is left in check
+        MoveUndo undo;
+        make_move(pos, create_move(input_position, next_position, NO_PROMOTION),
+                  &undo);
+        if (is_check(pos, color_moving)) {
+            unset_bit(pos_mov, next_position);
+        }
+        unmake_move(pos, &undo);
     }
 }
 
-void render_board(SDL_Renderer *renderer, char board[8][8], Piece pieces[],
-                  Square sel_square, uint64_t pos_mov, int render_bool,
-                  GameState *game_state)
+int is_legal_move(Position *pos, Move move)
 {
-    for (int row = 0; row < 8; row++) {
-        for (int file = 0; file < 8; file++) {
-            int y = 7 - row;
-            int x = file;
-
-            SDL_Rect rect = {x * SQUARE_SIZE, y * SQUARE_SIZE, SQUARE_SIZE,
-                             SQUARE_SIZE};
-            if (sel_square.file == file && sel_square.row == row) {
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-
-                SDL_SetRenderDrawColor(renderer, 60, 80, 50, 180);
-                SDL_RenderFillRect(renderer, &rect);
-            } else if ((x + row) % 2 == 1)
-                SDL_SetRenderDrawColor(renderer, 240, 217, 181, 255);
-            else
-                SDL_SetRenderDrawColor(renderer, 181, 136, 99, 255);
-
-            SDL_RenderFillRect(renderer, &rect);
-
-            if (board[row][file] != 0) {
-                SDL_Texture *tex = NULL;
-                for (int i = 0; i < 12; i++) {
-                    char symbol = pieces[i].symbol;
-                    if (symbol == board[row][file]) {
-                        SDL_Surface *surface = IMG_Load(get_image_path(symbol));
-                        if (!surface) {
-                            printf("Failed to load image: %s\n",
-                                   IMG_GetError());
-                            continue;
-                        }
-                        tex = SDL_CreateTextureFromSurface(renderer, surface);
-                        SDL_FreeSurface(surface);
-                        break;
-                    }
-                }
-                if (tex) {
-                    SDL_Rect pieceRect = {x * SQUARE_SIZE, y * SQUARE_SIZE,
-                                          SQUARE_SIZE, SQUARE_SIZE};
-                    SDL_RenderCopy(renderer, tex, NULL, &pieceRect);
-                }
-            }
-        }
+    int from = get_move_from(move);
+    int to = get_move_to(move);
+    int piece_index = find_piece_by_position(pos, from);
+
+    if (piece_index < 0 ||
+        get_pieces()[piece_index].color != pos->side_to_move ||
+        get_move_promotion(move) > PROMOTE_QUEEN) {
+        return 0;
+    }
+    Square input_square = square_from_position(from);
+    uint64_t pos_mov = find_possible_moves(pos, input_square);
+
+    // Only the requested move goes through the make/check/unmake validation
+    pos_mov &= (uint64_t) 1 << to;
+    validate_possible_moves(pos, &pos_mov, input_square);
+    if (pos_mov == 0) {
+        return 0;
     }
-    draw_possible_moves(renderer, board, pos_mov);
-
-    if (game_state->is_check) {
-        SDL_SetRenderDrawColor(renderer, 220, 50, 50, 180);
 
-        char color_moving = color_to_move(game_state);
-        int king_index =
-            color_moving == 'w' ? WHITE_KING_INDEX : BLACK_KING_INDEX;
-        int king_position = get_lowest_bit_index(*(pieces[king_index].pos_bb));
-        Square king_square = square_from_position(king_position);
+    // Promotions must name their piece, other moves must not
+    char symbol = get_pieces()[piece_index].symbol;
+    int promotes =
+        (symbol == 'P' && to / 8 == 7) || (symbol == 'p' && to / 8 == 0);
+    return promotes == (get_move_promotion(move) != NO_PROMOTION);
+}
 
-        int center_x = king_square.file * SQUARE_SIZE + SQUARE_SIZE / 2;
-        int center_y = (7 - king_square.row) * SQUARE_SIZE + SQUARE_SIZE / 2;
-        int radius = SQUARE_SIZE / 2;
+int generate_destination_maps(Position *pos, uint64_t destinations[64])
+{
+    const Piece *pieces = get_pieces();
+    int count = 0;
 
-        for (int w = 0; w < radius * 2; w++) {
-            for (int h = 0; h < radius * 2; h++) {
-                int dx = radius - w;
-                int dy = radius - h;
-                if ((dx * dx + dy * dy) <= (radius * radius)) {
-                    SDL_RenderDrawPoint(renderer, center_x + dx, center_y + dy);
-                }
-            }
+    memset(destinations, 0, 64 * sizeof(uint64_t));
+    for (int i = 0; i < 12; i++) {
+        if (pieces[i].color != pos->side_to_move) {
+            continue;
+        }
+        uint64_t piece_bb = pos->bitboards[i];
+        while (piece_bb) {
+            int position = get_lowest_bit_index(piece_bb);
+            Square selected_square = square_from_position(position);
+            uint64_t pos_mov = find_possible_moves(pos, selected_square);
+            validate_possible_moves(pos, &pos_mov, selected_square);
+
+            destinations[position] = pos_mov;
+            count += count_bits(pos_mov);
+            piece_bb &= piece_bb - 1;
         }
     }
-
-    if (render_bool) {
-        SDL_RenderPresent(renderer);
-    }
+    return count;
 }
 
-void bitboards_to_board(Piece pieces[], char board[8][8])
+int generate_legal_moves(Position *pos, Move moves[MAX_MOVES])
 {
-    for (int rank = 7; rank >= 0; rank--) {
-        for (int file = 0; file < 8; file++) {
-            int sq = rank * 8 + file;
-            uint64_t mask = (uint64_t) 1 << sq;
-            char piece = 0;
+    uint64_t destinations[64];
+    int count = 0;
 
-            for (int i = 0; i < 12; i++) {
-                if (*(pieces[i].pos_bb) & mask) {
-                    piece = pieces[i].symbol;
+    if (generate_destination_maps(pos, destinations) == 0) {
+        return 0;
+    }
+    uint64_t pawns = pos->bitboards[WHITE_PAWN_INDEX] & 0x00FF000000000000ULL;
+    pawns |= pos->bitboards[BLACK_PAWN_INDEX] & 0x000000000000FF00ULL;
+
+    for (int position = 0; position < 64; position++) {
+        uint64_t pos_mov = destinations[position];
+        int promotes = is_bit_set(pawns, position);
+        while (pos_mov) {
+            int target = get_lowest_bit_index(pos_mov);
+            if (promotes) {
+                for (int p = PROMOTE_KNIGHT; p <= PROMOTE_QUEEN; p++) {
+                    moves[count++] = create_move(position, target, p);
                 }
+            } else {
+                moves[count++] = create_move(position, target, NO_PROMOTION);
             }
-            board[rank][file] = piece;
+            pos_mov &= pos_mov - 1;
         }
     }
+    return count;
 }
 
-void render_promotion_squares(SDL_Renderer *renderer, Square output_square,
-                              Piece pieces[], int direction,
-                              char promotion_pieces[], GameState *game_state)
+// Squares strictly between from and to when they share a diagonal (or a row
+// or file when diagonal is 0), otherwise nothing
+static uint64_t find_line_between(int from, int to, int diagonal)
 {
-    char board[8][8];
-    Square fake_square = {-1, -1};
-    bitboards_to_board(pieces, board);
-    uint64_t pos_mov = (uint64_t) 0;
-    int render_bool = 0;
-
-    render_board(renderer, board, pieces, fake_square, pos_mov, render_bool,
-                 game_state);
-
-    SDL_SetRenderDrawColor(renderer, 211, 211, 211, 255);
-    for (int i = 0; i < 4; i++) {
-        int row = (7 - output_square.row + (i * direction));
-        int file = output_square.file;
-        int center_x = file * SQUARE_SIZE + SQUARE_SIZE / 2;
-        int center_y = row * SQUARE_SIZE + SQUARE_SIZE / 2;
-        int radius = SQUARE_SIZE / 2;
-        for (int w = 0; w < radius * 2; w++) {
-            for (int h = 0; h < radius * 2; h++) {
-                int dx = radius - w;
-                int dy = radius - h;
-                if ((dx * dx + dy * dy) <= (radius * radius)) {
-                    SDL_RenderDrawPoint(renderer, center_x + dx, center_y + dy);
+    int file_step = (to % 8 > from % 8) - (to % 8 < from % 8);
+    int row_step = (to / 8 > from / 8) - (to / 8 < from / 8);
+    int file_distance = abs(to % 8 - from % 8);
+    int row_distance = abs(to / 8 - from / 8);
+    uint64_t line = (uint64_t) 0;
+
+    if (from == to ||
+        (diagonal ? file_distance != row_distance
+                  : file_distance != 0 && row_distance != 0)) {
+        return line;
+    }
+    for (int i = from + row_step * 8 + file_step; i != to;
+         i += row_step * 8 + file_step) {
+        set_bit(&line, i);
+    }
+    return line;
+}
+
+int generate_quiet_checks(Position *pos, Move moves[MAX_MOVES])
+{
+    const Piece *pieces = get_pieces();
+    char color = pos->side_to_move;
+    int king_index = color == 'w' ? BLACK_KING_INDEX : WHITE_KING_INDEX;
+    int king = get_lowest_bit_index(pos->bitboards[king_index]);
+    uint64_t full_board = get_full_board(pos);
+    uint64_t own_board = get_color_board(pos, color);
+    uint64_t discoverers = (uint64_t) 0;
+    uint64_t blocking_lines[64];
+    int count = 0;
+
+    // An own piece alone between an own slider and the enemy king gives
+    // check by leaving the line
+    for (int i = 0; i < 12; i++) {
+        char symbol = pieces[i].symbol | ('a' - 'A');
+        if (pieces[i].color != color ||
+            (symbol != 'b' && symbol != 'r' && symbol != 'q')) {
+            continue;
+        }
+        uint64_t slider_bb = pos->bitboards[i];
+        while (slider_bb) {
+            int slider = get_lowest_bit_index(slider_bb);
+            slider_bb &= slider_bb - 1;
+            for (int diagonal = 0; diagonal <= 1; diagonal++) {
+                if ((diagonal && symbol == 'r') ||
+                    (!diagonal && symbol == 'b')) {
+                    continue;
+                }
+                uint64_t line = find_line_between(slider, king, diagonal);
+                uint64_t blockers = line & full_board;
+                if (blockers && !(blockers & (blockers - 1)) &&
+                    (blockers & own_board)) {
+                    int blocker = get_lowest_bit_index(blockers);
+                    discoverers |= blockers;
+                    blocking_lines[blocker] = line;
                 }
             }
         }
-        SDL_Texture *tex = NULL;
-        char symbol = promotion_pieces[i];
-        SDL_Surface *surface = IMG_Load(get_image_path(symbol));
-        if (!surface) {
-            printf("Failed to load image: %s\n", IMG_GetError());
+    }
+
+    for (int i = 0; i < 12; i++) {
+        if (pieces[i].color != color) {
             continue;
         }
-        tex = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_FreeSurface(surface);
-        if (tex) {
-            SDL_Rect pieceRect = {file * SQUARE_SIZE, row * SQUARE_SIZE,
-                                  SQUARE_SIZE, SQUARE_SIZE};
-            SDL_RenderCopy(renderer, tex, NULL, &pieceRect);
+        char symbol = pieces[i].symbol | ('a' - 'A');
+        // Squares from which this piece type attacks the king, seen from
+        // the king with the colors swapped for pawns
+        uint64_t direct_checks = (uint64_t) 0;
+        if (symbol == 'p') {
+            direct_checks = find_piece_attacks(i ^ 1, king, 0, full_board);
+        } else if (symbol != 'k') {
+            direct_checks = find_piece_attacks(i, king, 0, full_board);
+        }
+
+        uint64_t piece_bb = pos->bitboards[i];
+        while (piece_bb) {
+            int position = get_lowest_bit_index(piece_bb);
+            piece_bb &= piece_bb - 1;
+            int discovers = is_bit_set(discoverers, position);
+            if (!discovers && !direct_checks && symbol != 'k') {
+                continue;
+            }
+            Square square = square_from_position(position);
+            uint64_t pos_mov = find_possible_moves(pos, square);
+            uint64_t checks = (uint64_t) 0;
+
+            if (symbol == 'k') {
+                // Castling checks with the rook, the only direct king check
+                uint64_t castles = pos_mov;
+                while (castles) {
+                    int target = get_lowest_bit_index(castles);
+                    castles &= castles - 1;
+                    MoveUndo undo;
+                    if (find_castle_right(pos, color, position, target) < 0) {
+                        continue;
+                    }
+                    make_move(pos, create_move(position, target, NO_PROMOTION),
+                              &undo);
+                    if (is_check(pos, color)) {
+                        set_bit(&checks, target);
+                    }
+                    unmake_move(pos, &undo);
+                    unset_bit(&pos_mov, target);
+                }
+            } else if (symbol == 'p') {
+                // Pushes only, promotions are not quiet
+                pos_mov &= (0x0101010101010101ULL << (position % 8)) &
+                           ~0xFF000000000000FFULL;
+            }
+            pos_mov &= ~full_board;
+
+            checks |= pos_mov & direct_checks;
+            if (discovers) {
+                checks |= pos_mov & ~blocking_lines[position];
+            }
+            validate_possible_moves(pos, &checks, square);
+            while (checks) {
+                int target = get_lowest_bit_index(checks);
+                moves[count++] = create_move(position, target, NO_PROMOTION);
+                checks &= checks - 1;
+            }
         }
     }
-    SDL_RenderPresent(renderer);
+    return count;
 }
 
-void get_promotion_pieces(char color, char promotion_pieces[4])
+int is_game_ended(Position *pos)
 {
-    if (color == 'w') {
-        promotion_pieces[0] = 'Q';
-        promotion_pieces[1] = 'R';
-        promotion_pieces[2] = 'N';
-        promotion_pieces[3] = 'B';
-    } else {
-        promotion_pieces[0] = 'q';
-        promotion_pieces[1] = 'r';
-        promotion_pieces[2] = 'n';
-        promotion_pieces[3] = 'b';
-    }
+    uint64_t destinations[64];
+    return generate_destination_maps(pos, destinations) == 0;
 }
 
-char get_promotion_piece(char color, int row)
+void set_start_position(Position *pos)
 {
+    memset(pos, 0, sizeof(*pos));
+    memcpy(pos->bitboards, get_start_bitboards(), sizeof(pos->bitboards));
+    pos->side_to_move = 'w';
+    pos->castle_rights = ALL_CASTLE_RIGHTS;
+    pos->en_passant = NO_SQUARE;
+    pos->halfmove_clock = 0;
+    pos->fullmove_number = 1;
+
+    init_castle_rule(&pos->castle_rules[WHITE_SHORT_CASTLE], 'w', 4, 7, 1);
+    init_castle_rule(&pos->castle_rules[WHITE_LONG_CASTLE], 'w', 4, 0, 0);
+    init_castle_rule(&pos->castle_rules[BLACK_SHORT_CASTLE], 'b', 4, 7, 1);
+    init_castle_rule(&pos->castle_rules[BLACK_LONG_CASTLE], 'b', 4, 0, 0);
+}
 
-    char promotion_pieces[4];
-    get_promotion_pieces(color, promotion_pieces);
-    if (color == 'b') {
-        return promotion_pieces[row];
-    } else {
-        int index = abs(row - 7);
-        return promotion_pieces[index];
+// Finds the rook for a castling letter: K/Q (k/q) take the outermost rook on
+// that side of the king, A-H (a-h) name the rook file as in Shredder-FEN
+int parse_castle_right(Position *pos, char letter)
+{
+    char color = letter >= 'a' ? 'b' : 'w';
+    char upper = color == 'b' ? letter - ('a' - 'A') : letter;
+    int rank_offset = color == 'w' ? 0 : 56;
+    int king_index = color == 'w' ? WHITE_KING_INDEX : BLACK_KING_INDEX;
+    int rook_index = color == 'w' ? WHITE_ROOK_INDEX : BLACK_ROOK_INDEX;
+    uint64_t rooks = (pos->bitboards[rook_index] >> rank_offset) & 0xFF;
+    int king_file =
+        get_lowest_bit_index(pos->bitboards[king_index]) - rank_offset;
+    int rook_file = -1;
+
+    if (king_file < 0 || king_file > 7) {
+        return -1;
     }
+    if (upper == 'K') {
+        for (int file = 7; file > king_file && rook_file < 0; file--) {
+            if (rooks & (1 << file)) {
+                rook_file = file;
+            }
+        }
+    } else if (upper == 'Q') {
+        for (int file = 0; file < king_file && rook_file < 0; file++) {
+            if (rooks & (1 << file)) {
+                rook_file = file;
+            }
+        }
+    } else if (upper >= 'A' && upper <= 'H' &&
+               (rooks & (1 << (upper - 'A')))) {
+        rook_file = upper - 'A';
+    }
+    if (rook_file < 0 || rook_file == king_file) {
+        return -1;
+    }
+
+    int short_castle = rook_file > king_file;
+    int right = color == 'w'
+                    ? (short_castle ? WHITE_SHORT_CASTLE : WHITE_LONG_CASTLE)
+                    : (short_castle ? BLACK_SHORT_CASTLE : BLACK_LONG_CASTLE);
+    init_castle_rule(&pos->castle_rules[right], color, king_file, rook_file,
+                     short_castle);
+    pos->castle_rights |= 1 << right;
+    return 0;
 }
 
-void validate_possible_moves(uint64_t *pos_mov, Square input_square,
-                             GameState *game_state)
+int position_from_fen(Position *pos, const char *fen)
 {
-    // This could be done by checking which piece attacks the king -> calculate
-    // which squares need to be blocked in order to fix check. Or take piece
-    // that sets king in check In case of double check always move the king
-    Piece *pieces = get_pieces();
+    const char *c = fen;
+    int row = 7;
+    int file = 0;
+
+    set_start_position(pos);
+    memset(pos->bitboards, 0, sizeof(pos->bitboards));
+    pos->castle_rights = 0;
+
+    for (; *c && *c != ' '; c++) {
+        if (*c == '/') {
+            if (file != 8 || row == 0) {
+                return -1;
+            }
+            row--;
+            file = 0;
+        } else if (*c >= '1' && *c <= '8') {
+            file += *c - '0';
+        } else {
+            int piece_index = get_piece_index(*c);
+            if (piece_index < 0 || file > 7) {
+                return -1;
+            }
+            set_bit(&pos->bitboards[piece_index], get_position(file, row));
+            file++;
+        }
+        if (file > 8) {
+            return -1;
+        }
+    }
+    if (row != 0 || file != 8 || *c++ != ' ') {
+        return -1;
+    }
+    if (count_bits(pos->bitboards[WHITE_KING_INDEX]) != 1 ||
+        count_bits(pos->bitboards[BLACK_KING_INDEX]) != 1) {
+        return -1;
+    }
 
-    int update_state = 0;
-    uint64_t copy_pos_mov = *pos_mov;
-    char color_moving = color_to_move(game_state) == 'w' ? 'b' : 'w';
-    int input_position = get_position(input_square.file, input_square.row);
-    Piece *piece = find_piece_by_position(input_position);
+    if ((*c != 'w' && *c != 'b') || c[1] != ' ') {
+        return -1;
+    }
+    pos->side_to_move = *c;
+    c += 2;
 
-    TeamState *team_state =
-        piece->color == 'w' ? game_state->white_state : game_state->black_state;
-    int real_move = 0;
-    while (copy_pos_mov) {
-        int next_position = get_lowest_bit_index(copy_pos_mov);
-        // For now don't make the move for castling
-        if ((piece->symbol == 'k' || piece->symbol == 'K') &&
-            ((next_position == WHITE_LONG_CASTLE_POSITION &&
-              team_state->long_castle_allowed) ||
-             (next_position == WHITE_SHORT_CASTLE_POSITION &&
-              team_state->short_castle_allowed) ||
-             (next_position == BLACK_LONG_CASTLE_POSITION &&
-              team_state->long_castle_allowed) ||
-             (next_position == BLACK_SHORT_CASTLE_POSITION &&
-              team_state->short_castle_allowed))) {
-            copy_pos_mov &= copy_pos_mov - 1;
-            continue;
+    if (*c == '-') {
+        c++;
+    } else {
+        for (; *c && *c != ' '; c++) {
+            if (parse_castle_right(pos, *c) != 0) {
+                return -1;
+            }
         }
-        Square output_square = square_from_position(next_position);
-        make_move(input_square, output_square, pieces, game_state, update_state,
-                  real_move);
+    }
+    if (*c++ != ' ') {
+        return -1;
+    }
 
-        if (is_check(pieces, game_state, color_moving)) {
-            unset_bit(pos_mov, next_position);
+    if (*c == '-') {
+        c++;
+    } else {
+        // Only a square the opponent's pawn just crossed can be taken on:
+        // empty, on the mover's sixth row and with that pawn in front of it.
+        // make_move() removes whatever stands there.
+        char en_passant_row = pos->side_to_move == 'w' ? '6' : '3';
+        if (c[0] < 'a' || c[0] > 'h' || c[1] != en_passant_row) {
+            return -1;
         }
-        make_move(output_square, input_square, pieces, game_state, update_state,
-                  real_move);
-        if (game_state->last_captured_piece != '\0') {
-            int output_pos =
-                get_position(output_square.file, output_square.row);
-            for (int i = 0; i < 12; i++) {
-                if (pieces[i].symbol == game_state->last_captured_piece) {
-                    set_bit(pieces[i].pos_bb, output_pos);
-                    break;
-                }
-            }
-            game_state->last_captured_piece = '\0';
+        int en_passant = get_position(c[0] - FILE_OFFSET, c[1] - ROW_OFFSET);
+        int pawn_square =
+            pos->side_to_move == 'w' ? en_passant - 8 : en_passant + 8;
+        int enemy_pawn_index =
+            pos->side_to_move == 'w' ? BLACK_PAWN_INDEX : WHITE_PAWN_INDEX;
+        if (find_piece_by_position(pos, en_passant) >= 0 ||
+            !is_bit_set(pos->bitboards[enemy_pawn_index], pawn_square)) {
+            return -1;
         }
-        copy_pos_mov &= copy_pos_mov - 1;
+        pos->en_passant = en_passant;
+        c += 2;
     }
-}
 
-int is_game_ended(Piece pieces[], GameState *game_state)
-{
-    char color_moving = color_to_move(game_state);
-    for (int i = 0; i < 12; i++) {
-        if (pieces[i].color == color_moving) {
-            uint64_t piece_bb = *(pieces[i].pos_bb);
-            while (piece_bb) {
-                int position = get_lowest_bit_index(piece_bb);
-                Square selected_square = square_from_position(position);
-                Piece *piece = find_piece_by_position(position);
-
-                if (piece != NULL) {
-                    uint64_t pos_mov =
-                        find_possible_moves(selected_square, piece, game_state);
-                    validate_possible_moves(&pos_mov, selected_square,
-                                            game_state);
-                    if (!(pos_mov == 0)) {
-                        return 0;
-                    }
-                }
-                piece_bb &= piece_bb - 1;
+    // The move counters are optional, EPD style strings leave them out.
+    // Values the uint16_t fields cannot hold are refused, not wrapped.
+    char *end;
+    long halfmove = strtol(c, &end, 10);
+    if (end != c) {
+        if (halfmove < 0 || halfmove > UINT16_MAX) {
+            return -1;
+        }
+        pos->halfmove_clock = (uint16_t) halfmove;
+        c = end;
+        long fullmove = strtol(c, &end, 10);
+        if (end != c) {
+            if (fullmove < 1 || fullmove > UINT16_MAX) {
+                return -1;
             }
+            pos->fullmove_number = (uint16_t) fullmove;
         }
     }
-    return 1;
+
+    // The side that just moved cannot have left its king in check
+    if (is_check(pos, pos->side_to_move)) {
+        return -1;
+    }
+    return 0;
 }
 
-int main()
+int position_to_fen(const Position *pos, char *fen, int size)
 {
-    GameState game_state = {0};
-    TeamState black_state = {1, 1};
-    TeamState white_state = {1, 1};
-
-    game_state.black_state = &black_state;
-    game_state.white_state = &white_state;
     char board[8][8];
+    char buffer[MAX_FEN_LENGTH];
+    int length = 0;
 
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("SDL_Init Error: %s\n", SDL_GetError());
-        return 1;
-    }
-
-    int imgFlags = IMG_INIT_PNG;
-    if (!(IMG_Init(imgFlags) & imgFlags)) {
-        printf("SDL_image could not initialize! SDL_image Error: %s\n",
-               IMG_GetError());
-        SDL_Quit();
-        return 1;
-    }
-
-    SDL_Window *window =
-        SDL_CreateWindow("Chessboard", SDL_WINDOWPOS_CENTERED,
-                         SDL_WINDOWPOS_CENTERED, 600, 600, SDL_WINDOW_SHOWN);
-
-    SDL_Renderer *renderer =
-        SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-
-    SDL_Event event;
-    Piece *pieces = get_pieces();
-    bitboards_to_board(pieces, board);
-
-    Square selected_square = {-1, -1};
-    Square previous_square = {-1, -1};
-    int awaiting_promotion = 0;
-
-    int needs_redraw = 1;
-    int running = 1;
-    int piece_selected = 0;
-    int promotion_rendered = 0;
-    uint64_t pos_mov = (uint64_t) 0;
-    char computer_color = 'b';
-
-    while (running) {
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT)
-                running = 0;
-            if (event.type == SDL_MOUSEBUTTONDOWN) {
-                int sel_file = event.button.x / SQUARE_SIZE;
-                int sel_row = 7 - (event.button.y / SQUARE_SIZE);
-
-                if (promotion_rendered) {
-                    char color_moving = color_to_move(&game_state);
-                    game_state.promote_pawn = 1;
-                    game_state.promote_to =
-                        get_promotion_piece(color_moving, sel_row);
-                    char last_move[5];
-                    squares_to_notation(previous_square, selected_square,
-                                        last_move);
-                    snprintf(game_state.last_move, sizeof(game_state.last_move),
-                             "%s", last_move);
-
-                    int update_state = 1;
-                    int real_move = 1;
-                    make_move(previous_square, selected_square, pieces,
-                              &game_state, update_state, real_move);
-                    selected_square = (Square) {-1, -1};
-                    needs_redraw = 1;
-                    promotion_rendered = 0;
-                    break;
-                }
-
-                previous_square =
-                    (Square) {selected_square.file, selected_square.row};
-
-                if (sel_file == selected_square.file &&
-                    sel_row == selected_square.row) {
-                    piece_selected = 0;
-                    selected_square = (Square) {-1, -1};
-                    pos_mov = (uint64_t) 0;
-                    needs_redraw = 1;
-                } else {
-                    int new_position = get_position(sel_file, sel_row);
-                    Piece *selected_piece =
-                        find_piece_by_position(new_position);
-                    if (selected_piece != NULL &&
-                        color_to_move(&game_state) != selected_piece->color &&
-                        !(is_bit_set(pos_mov, new_position))) {
-                        break;
-                    }
-                    selected_square = (Square) {sel_file, sel_row};
-                }
-
-                if (!(selected_square.file == -1 &&
-                      selected_square.row == -1)) {
-                    int position =
-                        get_position(selected_square.file, selected_square.row);
-
-                    Piece *piece = find_piece_by_position(position);
-
-                    if (piece_selected && is_bit_set(pos_mov, position)) {
-                        int previous_position = get_position(
-                            previous_square.file, previous_square.row);
-                        Piece *previous_piece =
-                            find_piece_by_position(previous_position);
-                        if (previous_piece != NULL &&
-                            ((previous_piece->symbol == 'P' &&
-                              selected_square.row == 7) ||
-                             (previous_piece->symbol == 'p' &&
-                              selected_square.row == 0))) {
-                            awaiting_promotion = 1;
-                        } else {
-                            char last_move[5];
-                            squares_to_notation(previous_square,
-                                                selected_square, last_move);
-                            snprintf(game_state.last_move,
-                                     sizeof(game_state.last_move), "%s",
-                                     last_move);
-                            int update_state = 1;
-                            int real_move = 1;
-                            make_move(previous_square, selected_square, pieces,
-                                      &game_state, update_state, real_move);
-                            selected_square = (Square) {-1, -1};
-                        }
-                        piece_selected = 0;
-                        pos_mov = (uint64_t) 0;
-                        needs_redraw = 1;
-                    } else if (!(piece == NULL)) {
-                        piece_selected = 1;
-                        pos_mov = find_possible_moves(selected_square, piece,
-                                                      &game_state);
-                        validate_possible_moves(&pos_mov, selected_square,
-                                                &game_state);
-                        needs_redraw = 1;
-                    } else {
-                        piece_selected = 0;
-                        pos_mov = (uint64_t) 0;
-                        needs_redraw = 0;
-                    }
-                }
+    bitboards_to_board(pos, board);
+    for (int row = 7; row >= 0; row--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            if (board[row][file] == 0) {
+                empty++;
+                continue;
             }
+            if (empty) {
+                buffer[length++] = '0' + empty;
+                empty = 0;
+            }
+            buffer[length++] = board[row][file];
+        }
+        if (empty) {
+            buffer[length++] = '0' + empty;
         }
+        buffer[length++] = row > 0 ? '/' : ' ';
+    }
+    buffer[length++] = pos->side_to_move;
+    buffer[length++] = ' ';
 
-        if (awaiting_promotion) {
-            char color_moving = color_to_move(&game_state);
-            int direction = color_moving == 'w' ? 1 : -1;
-            char promotion_pieces[4];
-            get_promotion_pieces(color_moving, promotion_pieces);
-            awaiting_promotion = 0;
-
-            render_promotion_squares(renderer, selected_square, pieces,
-                                     direction, promotion_pieces, &game_state);
-            needs_redraw = 0;
-            promotion_rendered = 1;
-        }
-
-        if (needs_redraw) {
-            int render_bool = 1;
-            pieces = get_pieces();
-            bitboards_to_board(pieces, board);
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-            render_board(renderer, board, pieces, selected_square, pos_mov,
-                         render_bool, &game_state);
-            needs_redraw = 0;
-
-            if (is_game_ended(pieces, &game_state)) {
-                if (game_state.is_check) {
-                    char *winning_color =
-                        (color_to_move(&game_state) == 'w') ? "Black" : "White";
-                    printf("%s won!!!\n", winning_color);
-                } else {
-                    printf("Game ended in draw!!!\n");
-                }
-                running = 0;
-            }
+    if (pos->castle_rights == 0) {
+        buffer[length++] = '-';
+    }
+    for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+        const CastleRule *rule = &pos->castle_rules[i];
+        if (!(pos->castle_rights & (1 << i))) {
+            continue;
+        }
+        // Chess960 rules are written with the rook file (Shredder-FEN)
+        char letter = 'A' + rule->rook_from % 8;
+        if (rule->target == rule->king_to) {
+            letter = rule->king_to % 8 == 6 ? 'K' : 'Q';
+        }
+        if (rule->color == 'b') {
+            letter += 'a' - 'A';
         }
-        SDL_Delay(10);
+        buffer[length++] = letter;
     }
 
+    if (pos->en_passant == NO_SQUARE) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, " -");
+    } else {
+        Square square = square_from_position(pos->en_passant);
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %c%c",
+                           FILE_OFFSET + square.file, ROW_OFFSET + square.row);
+    }
+    length += snprintf(buffer + length, sizeof(buffer) - length, " %d %d",
+                       pos->halfmove_clock, pos->fullmove_number);
+
+    if (length >= size) {
+        return -1;
+    }
+    memcpy(fen, buffer, length + 1);
     return 0;
-}
\ No newline at end of file
+}
@@ -4,7 +4,12 @@
 #define SQUARE_SIZE 75
 #define FILE_OFFSET 'a'
 #define ROW_OFFSET '1'
+#define NO_SQUARE -1
+#define MAX_MOVES 256
+#define MAX_FEN_LENGTH 100
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct {
@@ -12,33 +17,164 @@ typedef struct {
     int row;
 } Square;
 
+typedef enum {
+    WHITE_SHORT_CASTLE,
+    WHITE_LONG_CASTLE,
+    BLACK_SHORT_CASTLE,
+    BLACK_LONG_CASTLE,
+    CASTLE_RIGHTS_COUNT
+} CastleRight;
+
+#define ALL_CASTLE_RIGHTS ((1 << CASTLE_RIGHTS_COUNT) - 1)
+
+// A move queued by the player who is waiting, tried as soon as the
+// opponent's move has been made
 typedef struct {
-    int short_castle_allowed;
-    int long_castle_allowed;
-} TeamState;
+    int queued;
+    Square from;
+    Square to;
+} Premove;
+
+// One entry per castling right. Castling is legal when the right is still
+// held, every square in empty_mask is free and no square in safe_mask is
+// attacked. target is the square clicked to castle: the king destination in
+// standard chess, the rook square in Chess960 where that would be ambiguous.
+typedef struct {
+    uint64_t empty_mask;
+    uint64_t safe_mask;
+    char color;
+    int8_t king_from;
+    int8_t king_to;
+    int8_t rook_from;
+    int8_t rook_to;
+    int8_t target;
+} CastleRule;
+
+typedef enum {
+    NO_PROMOTION,
+    PROMOTE_KNIGHT,
+    PROMOTE_BISHOP,
+    PROMOTE_ROOK,
+    PROMOTE_QUEEN
+} Promotion;
+
+// Packed move: from square in bits 0-5, to square in bits 6-11 and the
+// Promotion in bits 12-14. Castling is the king moving to its rule target.
+typedef uint16_t Move;
+
+// Everything needed to play from a position. Positions own all of their
+// state, so separate positions can be used from separate threads.
+// Cache line aligned: the bitboards and the fields make_move() touches fill
+// the first two lines, the castle rules that only castling reads come after.
+// Heap copies need 64 byte aligned storage (aligned_alloc), malloc() and
+// realloc() do not guarantee it.
+typedef struct {
+    _Alignas(64) uint64_t bitboards[12]; // Indexed like the pieces table
+    char side_to_move;
+    uint8_t castle_rights;
+    int8_t en_passant; // Square a pawn can capture onto, or NO_SQUARE
+    uint16_t halfmove_clock;
+    uint16_t fullmove_number;
+    CastleRule castle_rules[CASTLE_RIGHTS_COUNT];
+} Position;
+
+_Static_assert(offsetof(Position, castle_rules) <= 128,
+               "hot Position fields must fit in two cache lines");
 
+// What make_move() overwrote, for unmake_move()
 typedef struct {
-    int total_moves;
-    char last_move[5];
-    char last_moved_piece;
-    int play_en_passant;
-    int promote_pawn;
-    char promote_to;
+    Move move;
+    int8_t moved_piece;
+    int8_t captured_piece;
+    int8_t capture_square;
+    int8_t castle_right;
+    uint8_t castle_rights;
+    int8_t en_passant;
+    uint16_t halfmove_clock;
+} MoveUndo;
+
+typedef struct {
+    Position pos;
     int is_check;
-    char last_captured_piece;
-    char castle_played;
-    TeamState *white_state;
-    TeamState *black_state;
+    // Legal destinations per square for the side to move, refreshed after
+    // every move so that clicks only look them up
+    uint64_t destinations[64];
+    int legal_move_count;
+    int moves_played;
 } GameState;
 
+static inline Move create_move(int from, int to, int promotion)
+{
+    return (Move) (from | (to << 6) | (promotion << 12));
+}
+
+static inline int get_move_from(Move move)
+{
+    return move & 0x3F;
+}
+
+static inline int get_move_to(Move move)
+{
+    return (move >> 6) & 0x3F;
+}
+
+static inline int get_move_promotion(Move move)
+{
+    return (move >> 12) & 0x7;
+}
+
 Square square_from_position(int position);
 
 int get_position(int file, int row);
 
-char color_to_move(GameState *game_state);
+char color_to_move(const Position *pos);
+
+int count_bits(uint64_t number);
+
+int get_lowest_bit_index(uint64_t bb);
 
 void set_bit(uint64_t *piece_bb, int position);
 
+void unset_bit(uint64_t *piece_bb, int position);
+
 void print_bitboard(uint64_t possible_moves);
 
-#endif
\ No newline at end of file
+void move_to_notation(Move move, char notation[6]);
+
+int promotion_from_symbol(char symbol);
+
+int calculate_total_piece_value(const Position *pos, char color);
+
+int evaluate(const Position *pos);
+
+int is_check(const Position *pos, char color_moving);
+
+void make_move(Position *pos, Move move, MoveUndo *undo);
+
+void unmake_move(Position *pos, const MoveUndo *undo);
+
+void validate_possible_moves(Position *pos, uint64_t *pos_mov,
+                             Square input_square);
+
+int is_legal_move(Position *pos, Move move);
+
+// Legal destinations of every piece of the side to move, indexed by square.
+// Returns the number of legal moves (promotions counted once), zero when the
+// game has ended.
+int generate_destination_maps(Position *pos, uint64_t destinations[64]);
+
+int generate_legal_moves(Position *pos, Move moves[MAX_MOVES]);
+
+// Legal moves that give check without capturing or promoting, direct checks
+// as well as discovered ones. Only the candidate moves are validated.
+int generate_quiet_checks(Position *pos, Move moves[MAX_MOVES]);
+
+int is_game_ended(Position *pos);
+
+void set_start_position(Position *pos);
+
+int position_from_fen(Position *pos, const char *fen);
+
+int position_to_fen(const Position *pos, char *fen, int size);
+
+#endif
@@ -0,0 +1,290 @@
+#include "gamecodec.h"
+
+#include "board.h"
+#include "threadpool.h"
+
+#include <stdint.h>
+
+#define RANGE_TOP (1U << 24)
+#define MODEL_INCREMENT 24
+#define MODEL_LIMIT 60000
+#define DECODE_GRAIN 16
+
+// Adaptive frequencies of the move indices. Only the first n entries are
+// used for a position with n legal moves.
+typedef struct {
+    uint16_t frequencies[MAX_MOVES];
+    uint32_t total;
+} IndexModel;
+
+// Carry-propagating range coder as in LZMA. The first byte it produces is
+// always zero and is left out.
+typedef struct {
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;
+    int pending; // Bytes held back for a carry, the cache included
+    int started;
+    uint8_t *out;
+    int size;
+    int length;
+} RangeEncoder;
+
+typedef struct {
+    uint32_t code;
+    uint32_t range;
+    const uint8_t *data;
+    int size;
+    int position;
+} RangeDecoder;
+
+static void init_index_model(IndexModel *model)
+{
+    for (int i = 0; i < MAX_MOVES; i++) {
+        model->frequencies[i] = 1;
+    }
+    model->total = MAX_MOVES;
+}
+
+static void update_index_model(IndexModel *model, int index)
+{
+    model->frequencies[index] += MODEL_INCREMENT;
+    model->total += MODEL_INCREMENT;
+    if (model->total <= MODEL_LIMIT) {
+        return;
+    }
+    model->total = 0;
+    for (int i = 0; i < MAX_MOVES; i++) {
+        model->frequencies[i] = (model->frequencies[i] + 1) / 2;
+        model->total += model->frequencies[i];
+    }
+}
+
+// Sum of the frequencies of the first n indices
+static uint32_t get_model_total(const IndexModel *model, int n)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < n; i++) {
+        total += model->frequencies[i];
+    }
+    return total;
+}
+
+static void put_byte(RangeEncoder *encoder, uint8_t byte)
+{
+    if (!encoder->started) {
+        encoder->started = 1;
+        return;
+    }
+    if (encoder->length < encoder->size) {
+        encoder->out[encoder->length] = byte;
+    }
+    encoder->length++;
+}
+
+static void shift_low(RangeEncoder *encoder)
+{
+    if ((uint32_t) encoder->low < 0xFF000000U || (encoder->low >> 32) != 0) {
+        uint8_t carry = encoder->low >> 32;
+        uint8_t byte = encoder->cache;
+        do {
+            put_byte(encoder, byte + carry);
+            byte = 0xFF;
+        } while (--encoder->pending);
+        encoder->cache = (encoder->low >> 24) & 0xFF;
+    }
+    encoder->pending++;
+    encoder->low = (encoder->low & 0x00FFFFFF) << 8;
+}
+
+static void encode_range(RangeEncoder *encoder, uint32_t start, uint32_t size,
+                         uint32_t total)
+{
+    encoder->range /= total;
+    encoder->low += (uint64_t) start * encoder->range;
+    encoder->range *= size;
+    while (encoder->range < RANGE_TOP) {
+        encoder->range <<= 8;
+        shift_low(encoder);
+    }
+}
+
+static uint8_t next_byte(RangeDecoder *decoder)
+{
+    // Reading past the end only happens on corrupt data
+    if (decoder->position >= decoder->size) {
+        decoder->position++;
+        return 0;
+    }
+    return decoder->data[decoder->position++];
+}
+
+static void decode_range(RangeDecoder *decoder, uint32_t start, uint32_t size)
+{
+    decoder->code -= start * decoder->range;
+    decoder->range *= size;
+    while (decoder->range < RANGE_TOP) {
+        decoder->code = (decoder->code << 8) | next_byte(decoder);
+        decoder->range <<= 8;
+    }
+}
+
+static void encode_index(RangeEncoder *encoder, IndexModel *model, int index,
+                         int n)
+{
+    uint32_t start = 0;
+    uint32_t total = 0;
+    for (int i = 0; i < n; i++) {
+        if (i == index) {
+            start = total;
+        }
+        total += model->frequencies[i];
+    }
+    encode_range(encoder, start, model->frequencies[index], total);
+    update_index_model(model, index);
+}
+
+// Returns -1 when the code does not fall inside the n legal moves
+static int decode_index(RangeDecoder *decoder, IndexModel *model, int n)
+{
+    uint32_t total = get_model_total(model, n);
+    decoder->range /= total;
+    uint32_t value = decoder->code / decoder->range;
+    if (value >= total) {
+        return -1;
+    }
+
+    uint32_t start = 0;
+    int index = 0;
+    while (start + model->frequencies[index] <= value) {
+        start += model->frequencies[index];
+        index++;
+    }
+    decode_range(decoder, start, model->frequencies[index]);
+    update_index_model(model, index);
+    return index;
+}
+
+// The stored index is into the legal moves sorted by packed Move value, so
+// that games stay readable whatever order the generator finds moves in
+static int generate_sorted_moves(Position *pos, Move moves[MAX_MOVES])
+{
+    int count = generate_legal_moves(pos, moves);
+    for (int i = 1; i < count; i++) {
+        Move move = moves[i];
+        int j = i;
+        for (; j > 0 && moves[j - 1] > move; j--) {
+            moves[j] = moves[j - 1];
+        }
+        moves[j] = move;
+    }
+    return count;
+}
+
+int encode_game(const Position *start, const Move *moves, int count,
+                uint8_t *out, int size)
+{
+    Position pos = *start;
+    IndexModel model;
+    RangeEncoder encoder = {0, 0xFFFFFFFFU, 0, 1, 0, NULL, 0, 0};
+    int length = 0;
+
+    // Move count first, seven bits per byte
+    unsigned int remaining = (unsigned int) count;
+    do {
+        if (length >= size) {
+            return -1;
+        }
+        out[length++] = (remaining & 0x7F) | (remaining > 0x7F ? 0x80 : 0);
+        remaining >>= 7;
+    } while (remaining);
+
+    encoder.out = out + length;
+    encoder.size = size - length;
+    init_index_model(&model);
+    for (int ply = 0; ply < count; ply++) {
+        Move legal[MAX_MOVES];
+        int n = generate_sorted_moves(&pos, legal);
+        int index = 0;
+        while (index < n && legal[index] != moves[ply]) {
+            index++;
+        }
+        if (index == n) {
+            return -1;
+        }
+        if (n > 1) {
+            encode_index(&encoder, &model, index, n);
+        }
+        MoveUndo undo;
+        make_move(&pos, moves[ply], &undo);
+    }
+    for (int i = 0; i < 5; i++) {
+        shift_low(&encoder);
+    }
+    if (encoder.length > encoder.size) {
+        return -1;
+    }
+    return length + encoder.length;
+}
+
+int decode_game(const Position *start, const uint8_t *data, int size,
+                Move *moves, int max_moves)
+{
+    Position pos = *start;
+    IndexModel model;
+    RangeDecoder decoder = {0, 0xFFFFFFFFU, data, size, 0};
+    unsigned int count = 0;
+    int shift = 0;
+
+    do {
+        if (decoder.position >= size || shift > 28) {
+            return -1;
+        }
+        count |= (unsigned int) (data[decoder.position] & 0x7F) << shift;
+        shift += 7;
+    } while (data[decoder.position++] & 0x80);
+    if (count > (unsigned int) max_moves) {
+        return -1;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        decoder.code = (decoder.code << 8) | next_byte(&decoder);
+    }
+    init_index_model(&model);
+    for (unsigned int ply = 0; ply < count; ply++) {
+        Move legal[MAX_MOVES];
+        int n = generate_sorted_moves(&pos, legal);
+        int index = n > 1 ? decode_index(&decoder, &model, n) : 0;
+        if (n == 0 || index < 0) {
+            return -1;
+        }
+        moves[ply] = legal[index];
+        MoveUndo undo;
+        make_move(&pos, moves[ply], &undo);
+    }
+    // Reading past the end means the data was cut short
+    if (decoder.position > size) {
+        return -1;
+    }
+    return (int) count;
+}
+
+static void decode_one_game(int index, void *arg)
+{
+    EncodedGame *game = &((EncodedGame *) arg)[index];
+    game->move_count = decode_game(game->start, game->data, game->size,
+                                   game->moves, game->max_moves);
+}
+
+int decode_games(ThreadPool *pool, EncodedGame *games, int count)
+{
+    int failed = 0;
+
+    if (parallel_for(pool, count, DECODE_GRAIN, decode_one_game, games) != 0) {
+        return count;
+    }
+    for (int i = 0; i < count; i++) {
+        failed += games[i].move_count < 0;
+    }
+    return failed;
+}
@@ -0,0 +1,40 @@
+#ifndef GAMECODEC_H
+#define GAMECODEC_H
+
+#include "board.h"
+#include "threadpool.h"
+
+#include <stdint.h>
+
+// Games are stored as the index of every move among the legal moves sorted
+// by packed Move value, which keeps the format independent of the order
+// generate_legal_moves() happens to use. The indices are range coded with an
+// adaptive model that restarts for every game.
+// Layout: move count as a little-endian base-128 varint, then the range
+// coder output. Forced moves take no space at all.
+
+// Upper bound on the encoded size of a game of count moves
+#define MAX_ENCODED_GAME_BYTES(count) (10 + 2 * (count))
+
+typedef struct {
+    const Position *start;
+    const uint8_t *data;
+    int size;
+    Move *moves;
+    int max_moves;
+    int move_count; // Set by decode_games(), -1 when the game is corrupt
+} EncodedGame;
+
+// Returns the number of bytes written, or -1 for an illegal move or when out
+// is too small
+int encode_game(const Position *start, const Move *moves, int count,
+                uint8_t *out, int size);
+
+// Returns the number of moves, or -1 when data is not a valid game from start
+int decode_game(const Position *start, const uint8_t *data, int size,
+                Move *moves, int max_moves);
+
+// Decodes the games on the pool and returns how many of them failed
+int decode_games(ThreadPool *pool, EncodedGame *games, int count);
+
+#endif
@@ -0,0 +1,20 @@
+#include "kpk.h"
+
+int probe_kpk(char strong_color, int strong_king, int pawn, int weak_king,
+              char side_to_move)
+{
+    // Flip a black pawn up the board, then mirror files e-h onto a-d
+    if (strong_color == 'b') {
+        strong_king ^= 56;
+        pawn ^= 56;
+        weak_king ^= 56;
+    }
+    if ((pawn & 7) > 3) {
+        strong_king ^= 7;
+        pawn ^= 7;
+        weak_king ^= 7;
+    }
+    int index = get_kpk_index(side_to_move == strong_color, strong_king,
+                              weak_king, pawn);
+    return (kpk_bitbase[index / 32] >> (index % 32)) & 1;
+}
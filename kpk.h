@@ -0,0 +1,26 @@
+#ifndef KPK_H
+#define KPK_H
+
+#include <stdint.h>
+
+// King and pawn against king win/draw bitbase, generated at build time by
+// kpkgen. Positions are normalized so that the pawn is white and on files
+// a-d, leaving 24 pawn squares. One bit per position, set when white wins.
+#define KPK_POSITIONS (2 * 64 * 64 * 24)
+#define KPK_WORDS (KPK_POSITIONS / 32)
+
+extern const uint32_t kpk_bitbase[KPK_WORDS];
+
+// The pawn must be on files a-d and rows 1-6
+static inline int get_kpk_index(int white_to_move, int white_king,
+                                int black_king, int pawn)
+{
+    return white_king | (black_king << 6) | (white_to_move << 12) |
+           ((pawn & 7) << 13) | ((6 - (pawn >> 3)) << 15);
+}
+
+// Returns 1 when the side with the pawn wins, 0 when it is a draw
+int probe_kpk(char strong_color, int strong_king, int pawn, int weak_king,
+              char side_to_move);
+
+#endif
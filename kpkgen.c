@@ -0,0 +1,172 @@
+// Builds the KPK bitbase by retrograde analysis and prints it as C source,
+// see kpk.h for the layout. Run by make, the output is not checked in.
+#include "kpk.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum { INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4 };
+
+static uint8_t results[KPK_POSITIONS];
+static uint64_t king_attacks[64];
+
+static uint64_t get_pawn_attacks(int pawn)
+{
+    uint64_t attacks = 0;
+    if ((pawn & 7) > 0) {
+        attacks |= 1ULL << (pawn + 7);
+    }
+    if ((pawn & 7) < 7) {
+        attacks |= 1ULL << (pawn + 9);
+    }
+    return attacks;
+}
+
+static void init_king_attacks(void)
+{
+    for (int square = 0; square < 64; square++) {
+        for (int row = -1; row <= 1; row++) {
+            for (int file = -1; file <= 1; file++) {
+                int to_row = (square >> 3) + row;
+                int to_file = (square & 7) + file;
+                if ((row || file) && to_row >= 0 && to_row < 8 &&
+                    to_file >= 0 && to_file < 8) {
+                    king_attacks[square] |= 1ULL << (to_row * 8 + to_file);
+                }
+            }
+        }
+    }
+}
+
+// Positions decided without looking at any move
+static int init_result(int white_to_move, int white_king, int black_king,
+                       int pawn)
+{
+    uint64_t black_king_bb = 1ULL << black_king;
+    uint64_t pawn_attacks = get_pawn_attacks(pawn);
+
+    if (white_king == black_king || pawn == white_king || pawn == black_king ||
+        (king_attacks[white_king] & black_king_bb) ||
+        (white_to_move && (pawn_attacks & black_king_bb))) {
+        return INVALID;
+    }
+
+    if (white_to_move) {
+        // Promotes and the queen cannot be taken
+        int promotion = pawn + 8;
+        if ((pawn >> 3) == 6 && promotion != white_king &&
+            promotion != black_king &&
+            (!(king_attacks[black_king] & (1ULL << promotion)) ||
+             (king_attacks[white_king] & (1ULL << promotion)))) {
+            return WIN;
+        }
+        return UNKNOWN;
+    }
+
+    uint64_t escapes = king_attacks[black_king] &
+                       ~(king_attacks[white_king] | pawn_attacks);
+    if (!escapes) {
+        return (pawn_attacks & black_king_bb) ? WIN : DRAW;
+    }
+    // Takes the undefended pawn
+    if (king_attacks[black_king] & ~king_attacks[white_king] &
+        (1ULL << pawn)) {
+        return DRAW;
+    }
+    return UNKNOWN;
+}
+
+// Combines the results of every move, illegal ones are INVALID and ignored
+static int classify(int white_to_move, int white_king, int black_king,
+                    int pawn)
+{
+    int combined = 0;
+
+    if (white_to_move) {
+        uint64_t moves = king_attacks[white_king];
+        while (moves) {
+            int to = __builtin_ctzll(moves);
+            moves &= moves - 1;
+            combined |= results[get_kpk_index(0, to, black_king, pawn)];
+        }
+        // Promotions are settled by init_result()
+        if ((pawn >> 3) < 6) {
+            int push = pawn + 8;
+            combined |= results[get_kpk_index(0, white_king, black_king, push)];
+            if ((pawn >> 3) == 1 && push != white_king && push != black_king) {
+                combined |= results[get_kpk_index(0, white_king, black_king,
+                                                  push + 8)];
+            }
+        }
+    } else {
+        uint64_t moves = king_attacks[black_king];
+        while (moves) {
+            int to = __builtin_ctzll(moves);
+            moves &= moves - 1;
+            combined |= results[get_kpk_index(1, white_king, to, pawn)];
+        }
+    }
+
+    int good = white_to_move ? WIN : DRAW;
+    int bad = white_to_move ? DRAW : WIN;
+    if (combined & good) {
+        return good;
+    }
+    return (combined & UNKNOWN) ? UNKNOWN : bad;
+}
+
+static void decode_index(int index, int *white_to_move, int *white_king,
+                         int *black_king, int *pawn)
+{
+    *white_king = index & 63;
+    *black_king = (index >> 6) & 63;
+    *white_to_move = (index >> 12) & 1;
+    *pawn = ((index >> 13) & 3) + (6 - (index >> 15)) * 8;
+}
+
+int main(void)
+{
+    int white_to_move, white_king, black_king, pawn;
+    int changed = 1;
+    int passes = 0;
+    int wins = 0;
+
+    init_king_attacks();
+    for (int i = 0; i < KPK_POSITIONS; i++) {
+        decode_index(i, &white_to_move, &white_king, &black_king, &pawn);
+        results[i] = init_result(white_to_move, white_king, black_king, pawn);
+    }
+
+    // Whatever is still unknown once nothing changes can never be won
+    while (changed) {
+        changed = 0;
+        passes++;
+        for (int i = 0; i < KPK_POSITIONS; i++) {
+            if (results[i] != UNKNOWN) {
+                continue;
+            }
+            decode_index(i, &white_to_move, &white_king, &black_king, &pawn);
+            results[i] = classify(white_to_move, white_king, black_king, pawn);
+            changed |= results[i] != UNKNOWN;
+        }
+    }
+
+    printf("// Generated by kpkgen, do not edit\n\n");
+    printf("#include \"kpk.h\"\n\n");
+    printf("const uint32_t kpk_bitbase[KPK_WORDS] = {");
+    for (int word = 0; word < KPK_WORDS; word++) {
+        uint32_t bits = 0;
+        for (int bit = 0; bit < 32; bit++) {
+            if (results[word * 32 + bit] == WIN) {
+                bits |= 1U << bit;
+                wins++;
+            }
+        }
+        printf("%s0x%08XU,", word % 5 ? " " : "\n    ", bits);
+    }
+    printf("\n};\n");
+
+    fprintf(stderr, "kpkgen: %d won positions after %d passes\n", wins,
+            passes);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "libchess.h"
+
+#include "board.h"
+#include "pieces.h"
+
+#include <stdint.h>
+#include <string.h>
+
+chess_move chess_move_from_uci(const char *uci)
+{
+    if (strlen(uci) < 4 || uci[0] < 'a' || uci[0] > 'h' || uci[1] < '1' ||
+        uci[1] > '8' || uci[2] < 'a' || uci[2] > 'h' || uci[3] < '1' ||
+        uci[3] > '8') {
+        return 0;
+    }
+    int from = get_position(uci[0] - FILE_OFFSET, uci[1] - ROW_OFFSET);
+    int to = get_position(uci[2] - FILE_OFFSET, uci[3] - ROW_OFFSET);
+    int promotion = NO_PROMOTION;
+    if (uci[4] != '\0') {
+        promotion = promotion_from_symbol(uci[4]);
+        if (promotion == NO_PROMOTION) {
+            return 0;
+        }
+    }
+    return create_move(from, to, promotion);
+}
+
+void chess_move_to_uci(chess_move move, char out[6])
+{
+    move_to_notation(move, out);
+}
+
+int chess_apply_moves(const char *fen, const chess_move *moves, int count,
+                      char *fen_out, int fen_out_size)
+{
+    Position pos;
+    if (position_from_fen(&pos, fen) != 0) {
+        return -1;
+    }
+
+    int played = 0;
+    while (played < count && is_legal_move(&pos, moves[played])) {
+        MoveUndo undo;
+        make_move(&pos, moves[played], &undo);
+        played++;
+    }
+
+    if (position_to_fen(&pos, fen_out, fen_out_size) != 0) {
+        return -1;
+    }
+    return played;
+}
+
+int chess_generate_moves(const char *const *fens, int count,
+                         chess_move *moves_out, int *move_counts)
+{
+    int invalid = 0;
+    for (int i = 0; i < count; i++) {
+        Position pos;
+        if (position_from_fen(&pos, fens[i]) != 0) {
+            move_counts[i] = -1;
+            invalid++;
+            continue;
+        }
+        move_counts[i] =
+            generate_legal_moves(&pos, &moves_out[i * CHESS_MAX_MOVES]);
+    }
+    return invalid;
+}
+
+int chess_evaluate(const char *const *fens, int count, int32_t *scores)
+{
+    int invalid = 0;
+    for (int i = 0; i < count; i++) {
+        Position pos;
+        if (position_from_fen(&pos, fens[i]) != 0) {
+            scores[i] = CHESS_INVALID_SCORE;
+            invalid++;
+            continue;
+        }
+        scores[i] = evaluate(&pos);
+    }
+    return invalid;
+}
@@ -0,0 +1,45 @@
+#ifndef LIBCHESS_H
+#define LIBCHESS_H
+
+// C interface of libchess.so. Every call works on positions it builds from
+// the FEN strings it is given, so concurrent callers never share state.
+// Batch calls write into caller-provided buffers and do not allocate.
+
+#include <stdint.h>
+
+#define CHESS_API __attribute__((visibility("default")))
+
+#define CHESS_MAX_MOVES 256
+#define CHESS_MAX_FEN 100
+#define CHESS_INVALID_SCORE INT32_MIN
+
+// From square in bits 0-5, to square in bits 6-11 and the promotion piece in
+// bits 12-14 (0 none, 1 knight, 2 bishop, 3 rook, 4 queen). Squares count
+// from a1 = 0 to h8 = 63. Castling is encoded as the king moving to g/c in
+// standard chess and onto its own rook in Chess960.
+typedef uint16_t chess_move;
+
+// Parses UCI notation such as "e2e4" or "e7e8q", returns 0 when malformed
+CHESS_API chess_move chess_move_from_uci(const char *uci);
+
+// Writes the UCI notation of move, out must hold 6 characters
+CHESS_API void chess_move_to_uci(chess_move move, char out[6]);
+
+// Plays count moves from fen and writes the resulting FEN to fen_out.
+// Returns the number of moves played, stopping at the first illegal one,
+// or -1 when fen cannot be parsed or fen_out is too small.
+CHESS_API int chess_apply_moves(const char *fen, const chess_move *moves,
+                                int count, char *fen_out, int fen_out_size);
+
+// Legal moves for each of count FENs. The moves of fens[i] are written to
+// moves_out[i * CHESS_MAX_MOVES] and their number to move_counts[i], which is
+// -1 for a FEN that cannot be parsed. Returns the number of such FENs.
+CHESS_API int chess_generate_moves(const char *const *fens, int count,
+                                   chess_move *moves_out, int *move_counts);
+
+// Static evaluation in centipawns from the side to move for each of count
+// FENs. Unparsable FENs score CHESS_INVALID_SCORE. Returns their number.
+CHESS_API int chess_evaluate(const char *const *fens, int count,
+                             int32_t *scores);
+
+#endif
@@ -0,0 +1,397 @@
+#include "assets.h"
+#include "board.h"
+#include "pieces.h"
+#include "render.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void get_promotion_pieces(char color, char promotion_pieces[4])
+{
+    if (color == 'w') {
+        promotion_pieces[0] = 'Q';
+        promotion_pieces[1] = 'R';
+        promotion_pieces[2] = 'N';
+        promotion_pieces[3] = 'B';
+    } else {
+        promotion_pieces[0] = 'q';
+        promotion_pieces[1] = 'r';
+        promotion_pieces[2] = 'n';
+        promotion_pieces[3] = 'b';
+    }
+}
+
+char get_promotion_piece(char color, int row)
+{
+
+    char promotion_pieces[4];
+    get_promotion_pieces(color, promotion_pieces);
+    if (color == 'b') {
+        return promotion_pieces[row];
+    } else {
+        int index = abs(row - 7);
+        return promotion_pieces[index];
+    }
+}
+
+void update_destinations(GameState *game_state)
+{
+    game_state->legal_move_count =
+        generate_destination_maps(&game_state->pos, game_state->destinations);
+}
+
+void play_move(Square input_square, Square output_square, int promotion,
+               GameState *game_state)
+{
+    MoveUndo undo;
+    char color_moving = color_to_move(&game_state->pos);
+    Move move = create_move(get_position(input_square.file, input_square.row),
+                            get_position(output_square.file, output_square.row),
+                            promotion);
+
+    make_move(&game_state->pos, move, &undo);
+    game_state->is_check = is_check(&game_state->pos, color_moving);
+    game_state->moves_played++;
+    update_destinations(game_state);
+}
+
+// Squares a premove may go to. The opponent's move can still capture, block
+// or vacate any square, so only the own king is treated as an obstacle.
+// play_premove() checks the move against the real position.
+uint64_t find_premove_targets(const Position *pos, int position)
+{
+    int piece_index = find_piece_by_position(pos, position);
+    if (piece_index < 0) {
+        return (uint64_t) 0;
+    }
+    const Piece *piece = &get_pieces()[piece_index];
+    int king_index = piece->color == 'w' ? WHITE_KING_INDEX : BLACK_KING_INDEX;
+    uint64_t own_king = pos->bitboards[king_index];
+    uint64_t targets =
+        find_piece_attacks(piece_index, position, own_king, own_king);
+
+    if (piece->symbol == 'P' || piece->symbol == 'p') {
+        int forward = piece->color == 'w' ? 8 : -8;
+        int start_row = piece->color == 'w' ? 1 : 6;
+        set_bit(&targets, position + forward);
+        if (position / 8 == start_row) {
+            set_bit(&targets, position + 2 * forward);
+        }
+    } else if (piece->symbol == 'K' || piece->symbol == 'k') {
+        for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+            const CastleRule *rule = &pos->castle_rules[i];
+            if ((pos->castle_rights & (1 << i)) &&
+                rule->king_from == position) {
+                set_bit(&targets, rule->target);
+            }
+        }
+    }
+    return targets;
+}
+
+int play_premove(Premove *premove, GameState *game_state)
+{
+    if (!premove->queued) {
+        return 0;
+    }
+    premove->queued = 0;
+
+    int from_position = get_position(premove->from.file, premove->from.row);
+    int piece_index = find_piece_by_position(&game_state->pos, from_position);
+    int promotion = NO_PROMOTION;
+    if (piece_index >= 0) {
+        char symbol = get_pieces()[piece_index].symbol;
+        if ((symbol == 'P' && premove->to.row == 7) ||
+            (symbol == 'p' && premove->to.row == 0)) {
+            // There is no time to ask, premoved pawns always become a queen
+            promotion = PROMOTE_QUEEN;
+        }
+    }
+    int to_position = get_position(premove->to.file, premove->to.row);
+    if (!is_bit_set(game_state->destinations[from_position], to_position)) {
+        return 0;
+    }
+    play_move(premove->from, premove->to, promotion, game_state);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    Uint64 start_time = SDL_GetPerformanceCounter();
+    GameState game_state = {0};
+    set_start_position(&game_state.pos);
+    const Piece *pieces = get_pieces();
+    char board[8][8];
+
+    // Optional Chess960 start position number (518 is the standard setup)
+    if (argc > 1 && setup_chess960(&game_state.pos, atoi(argv[1])) != 0) {
+        printf("Invalid Chess960 position: %s (expected 0-959)\n", argv[1]);
+        return 1;
+    }
+    update_destinations(&game_state);
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init Error: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    int imgFlags = IMG_INIT_PNG;
+    if (!(IMG_Init(imgFlags) & imgFlags)) {
+        printf("SDL_image could not initialize! SDL_image Error: %s\n",
+               IMG_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    // Decode the embedded piece images while the window is being created
+    if (start_asset_loader() != 0) {
+        SDL_Quit();
+        return 1;
+    }
+
+    SDL_Window *window =
+        SDL_CreateWindow("Chessboard", SDL_WINDOWPOS_CENTERED,
+                         SDL_WINDOWPOS_CENTERED, 600, 600, SDL_WINDOW_SHOWN);
+
+    SDL_Renderer *renderer =
+        SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+
+    SDL_Texture *atlas = finish_asset_loader(renderer);
+    BoardRenderer board_renderer;
+    if (!atlas || init_board_renderer(&board_renderer, renderer, atlas) != 0) {
+        SDL_Quit();
+        return 1;
+    }
+    int first_frame = 1;
+
+    SDL_Event event;
+    bitboards_to_board(&game_state.pos, board);
+
+    Square selected_square = {-1, -1};
+    Square previous_square = {-1, -1};
+    int awaiting_promotion = 0;
+
+    int needs_redraw = 1;
+    int running = 1;
+    int piece_selected = 0;
+    int promotion_rendered = 0;
+    uint64_t pos_mov = (uint64_t) 0;
+
+    Premove premove = {0};
+    Square premove_square = {-1, -1};
+    int premove_selected = 0;
+    uint64_t premove_moves = (uint64_t) 0;
+    Uint64 premove_started = 0;
+
+    while (running) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT)
+                running = 0;
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h) {
+                // Coaching overlay: which side controls each square
+                toggle_heatmap(&board_renderer);
+                needs_redraw = 1;
+            }
+            if (event.type == SDL_MOUSEBUTTONDOWN) {
+                int sel_file = event.button.x / SQUARE_SIZE;
+                int sel_row = 7 - (event.button.y / SQUARE_SIZE);
+
+                if (event.button.button == SDL_BUTTON_RIGHT) {
+                    // Right click drops the premove
+                    premove.queued = 0;
+                    premove_selected = 0;
+                    premove_moves = (uint64_t) 0;
+                    needs_redraw = 1;
+                    continue;
+                }
+
+                if (promotion_rendered) {
+                    char color_moving = color_to_move(&game_state.pos);
+                    int promotion = promotion_from_symbol(
+                        get_promotion_piece(color_moving, sel_row));
+                    play_move(previous_square, selected_square, promotion,
+                              &game_state);
+                    premove_started = SDL_GetPerformanceCounter();
+                    if (!play_premove(&premove, &game_state)) {
+                        premove_started = 0;
+                    }
+                    selected_square = (Square) {-1, -1};
+                    needs_redraw = 1;
+                    promotion_rendered = 0;
+                    break;
+                }
+
+                if (premove_selected) {
+                    int position = get_position(sel_file, sel_row);
+                    premove_selected = 0;
+                    needs_redraw = 1;
+                    if (is_bit_set(premove_moves, position)) {
+                        premove = (Premove) {1, premove_square,
+                                             (Square) {sel_file, sel_row}};
+                        premove_moves = (uint64_t) 0;
+                        continue;
+                    }
+                    premove_moves = (uint64_t) 0;
+                    if (sel_file == premove_square.file &&
+                        sel_row == premove_square.row) {
+                        continue;
+                    }
+                }
+
+                previous_square =
+                    (Square) {selected_square.file, selected_square.row};
+
+                if (sel_file == selected_square.file &&
+                    sel_row == selected_square.row) {
+                    piece_selected = 0;
+                    selected_square = (Square) {-1, -1};
+                    pos_mov = (uint64_t) 0;
+                    needs_redraw = 1;
+                } else {
+                    int new_position = get_position(sel_file, sel_row);
+                    int selected_piece =
+                        find_piece_by_position(&game_state.pos, new_position);
+                    if (selected_piece >= 0 &&
+                        color_to_move(&game_state.pos) !=
+                            pieces[selected_piece].color &&
+                        !(is_bit_set(pos_mov, new_position))) {
+                        // Piece of the waiting player, pick its premove
+                        premove_selected = 1;
+                        premove_square = (Square) {sel_file, sel_row};
+                        premove_moves = find_premove_targets(
+                            &game_state.pos, new_position);
+                        piece_selected = 0;
+                        selected_square = (Square) {-1, -1};
+                        pos_mov = (uint64_t) 0;
+                        needs_redraw = 1;
+                        break;
+                    }
+                    selected_square = (Square) {sel_file, sel_row};
+                }
+
+                if (!(selected_square.file == -1 &&
+                      selected_square.row == -1)) {
+                    int position =
+                        get_position(selected_square.file, selected_square.row);
+
+                    int piece =
+                        find_piece_by_position(&game_state.pos, position);
+
+                    if (piece_selected && is_bit_set(pos_mov, position)) {
+                        int previous_position = get_position(
+                            previous_square.file, previous_square.row);
+                        int previous_piece = find_piece_by_position(
+                            &game_state.pos, previous_position);
+                        if (previous_piece >= 0 &&
+                            ((pieces[previous_piece].symbol == 'P' &&
+                              selected_square.row == 7) ||
+                             (pieces[previous_piece].symbol == 'p' &&
+                              selected_square.row == 0))) {
+                            awaiting_promotion = 1;
+                        } else {
+                            play_move(previous_square, selected_square,
+                                      NO_PROMOTION, &game_state);
+                            premove_started = SDL_GetPerformanceCounter();
+                            if (!play_premove(&premove, &game_state)) {
+                                premove_started = 0;
+                            }
+                            selected_square = (Square) {-1, -1};
+                        }
+                        piece_selected = 0;
+                        pos_mov = (uint64_t) 0;
+                        needs_redraw = 1;
+                    } else if (piece >= 0) {
+                        piece_selected = 1;
+                        pos_mov = game_state.destinations[position];
+                        needs_redraw = 1;
+                    } else {
+                        piece_selected = 0;
+                        pos_mov = (uint64_t) 0;
+                        needs_redraw = 0;
+                    }
+                }
+            }
+        }
+
+        if (awaiting_promotion) {
+            char color_moving = color_to_move(&game_state.pos);
+            int direction = color_moving == 'w' ? 1 : -1;
+            char promotion_pieces[4];
+            get_promotion_pieces(color_moving, promotion_pieces);
+            awaiting_promotion = 0;
+
+            render_promotion_squares(&board_renderer, selected_square,
+                                     direction, promotion_pieces, &game_state);
+            needs_redraw = 0;
+            promotion_rendered = 1;
+        }
+
+        if (needs_redraw) {
+            int render_bool = 1;
+            bitboards_to_board(&game_state.pos, board);
+
+            uint64_t premove_bb = (uint64_t) 0;
+            if (premove.queued) {
+                set_bit(&premove_bb,
+                        get_position(premove.from.file, premove.from.row));
+                set_bit(&premove_bb,
+                        get_position(premove.to.file, premove.to.row));
+            }
+            if (premove_selected) {
+                render_board(&board_renderer, board, premove_square,
+                             premove_moves, premove_bb, render_bool,
+                             &game_state);
+            } else {
+                render_board(&board_renderer, board, selected_square, pos_mov,
+                             premove_bb, render_bool, &game_state);
+            }
+            needs_redraw = 0;
+
+            if (premove_started) {
+                double premove_ms =
+                    (double) (SDL_GetPerformanceCounter() - premove_started) *
+                    1000.0 / (double) SDL_GetPerformanceFrequency();
+                printf("Premove on the board %.2f ms after the opponent's "
+                       "move\n",
+                       premove_ms);
+                premove_started = 0;
+            }
+
+            char title[64];
+            snprintf(title, sizeof(title),
+                     "Chessboard - %d draw calls, %.2f ms/frame",
+                     board_renderer.draw_calls, board_renderer.frame_ms);
+            SDL_SetWindowTitle(window, title);
+
+            if (first_frame) {
+                double first_frame_ms =
+                    (double) (SDL_GetPerformanceCounter() - start_time) *
+                    1000.0 / (double) SDL_GetPerformanceFrequency();
+                printf("First frame after %.1f ms (image decoding %.1f ms)\n",
+                       first_frame_ms, get_asset_decode_ms());
+                first_frame = 0;
+            }
+
+            if (game_state.legal_move_count == 0) {
+                if (game_state.is_check) {
+                    char *winning_color =
+                        (color_to_move(&game_state.pos) == 'w') ? "Black"
+                                                                : "White";
+                    printf("%s won!!!\n", winning_color);
+                } else {
+                    printf("Game ended in draw!!!\n");
+                }
+                running = 0;
+            }
+        }
+        SDL_Delay(10);
+    }
+
+    destroy_board_renderer(&board_renderer);
+    SDL_DestroyTexture(atlas);
+    return 0;
+}
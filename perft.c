@@ -0,0 +1,795 @@
+#include "board.h"
+#include "gamecodec.h"
+#include "pieces.h"
+#include "threadpool.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RANDOM_GAME_PLIES 200
+#define BENCH_TASKS 200000
+#define CANCEL_TASKS 256
+#define CHECK_BENCH_DEPTH 2
+#define CHECK_BENCH_ROUNDS 5
+
+typedef struct {
+    const char *name;
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+} PerftCase;
+
+// Reference node counts from the Chess Programming Wiki perft results. The
+// depths keep the whole suite to a few seconds.
+static const PerftCase perft_suite[] = {
+    {"start position", START_FEN, 4, 197281},
+    {"kiwipete",
+     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3,
+     97862},
+    {"en passant and pins", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5,
+     674624},
+    {"castling and promotion",
+     "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4,
+     422333},
+    {"promotion with check",
+     "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+    {"middlegame",
+     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     3, 89890},
+    {"underpromotion", "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1", 4, 182838},
+    {"chess960 castling",
+     "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", 4,
+     326672},
+};
+
+// FENs position_from_fen() must refuse, each one once slipped through
+static const PerftCase rejected_fens[] = {
+    {"en passant, own pawn behind", "4k3/8/8/3PP3/8/8/8/4K3 w - e6 0 1", 0, 0},
+    {"en passant, wrong row", "4k3/8/8/8/3pP3/8/8/4K3 w - e3 0 1", 0, 0},
+    {"en passant, occupied", "4k3/8/4p3/3Pp3/8/8/8/4K3 w - e6 0 1", 0, 0},
+    {"counters out of range", "4k3/8/8/8/8/8/8/4K3 w - - 70000 70000", 0, 0},
+};
+
+// Game g is played from seed + g so that any failure can be replayed alone
+typedef struct {
+    uint64_t seed;
+    atomic_ullong positions;
+    atomic_int failed;
+} RandomRun;
+
+typedef struct {
+    Position *positions;
+    int count;
+    int capacity;
+} PositionList;
+
+// Root moves are counted as separate tasks
+typedef struct {
+    Position root;
+    Move moves[MAX_MOVES];
+    uint64_t nodes[MAX_MOVES];
+    int depth;
+} RootSplit;
+
+static double elapsed_ms(struct timespec start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1000.0 +
+           (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+uint64_t perft(Position *pos, int depth)
+{
+    Move moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    if (depth == 1) {
+        return count;
+    }
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        make_move(pos, moves[i], &undo);
+        nodes += perft(pos, depth - 1);
+        unmake_move(pos, &undo);
+    }
+    return nodes;
+}
+
+static void perft_root_move(int index, void *arg)
+{
+    RootSplit *split = arg;
+    Position pos = split->root;
+    MoveUndo undo;
+
+    make_move(&pos, split->moves[index], &undo);
+    split->nodes[index] = split->depth > 1 ? perft(&pos, split->depth - 1) : 1;
+}
+
+static uint64_t parallel_perft(ThreadPool *pool, Position *pos, int depth)
+{
+    RootSplit split;
+    uint64_t nodes = 0;
+
+    split.root = *pos;
+    split.depth = depth;
+    int count = generate_legal_moves(pos, split.moves);
+    parallel_for(pool, count, 1, perft_root_move, &split);
+    for (int i = 0; i < count; i++) {
+        nodes += split.nodes[i];
+    }
+    return nodes;
+}
+
+// Node count per root move, to find where a wrong total comes from
+static uint64_t divide(Position *pos, int depth)
+{
+    Move moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    uint64_t total = 0;
+
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        char notation[6];
+        make_move(pos, moves[i], &undo);
+        uint64_t nodes = depth > 1 ? perft(pos, depth - 1) : 1;
+        unmake_move(pos, &undo);
+
+        move_to_notation(moves[i], notation);
+        printf("%s: %llu\n", notation, (unsigned long long) nodes);
+        total += nodes;
+    }
+    return total;
+}
+
+static uint64_t next_random(uint64_t *state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static int castle_rules_equal(const CastleRule *a, const CastleRule *b)
+{
+    return a->color == b->color && a->king_from == b->king_from &&
+           a->king_to == b->king_to && a->rook_from == b->rook_from &&
+           a->rook_to == b->rook_to && a->target == b->target &&
+           a->empty_mask == b->empty_mask && a->safe_mask == b->safe_mask;
+}
+
+// Field by field, memcmp would also compare padding. Rules of rights that
+// are gone only matter when all_rules is set, a FEN cannot carry them.
+static int positions_equal(const Position *a, const Position *b, int all_rules)
+{
+    if (memcmp(a->bitboards, b->bitboards, sizeof(a->bitboards)) != 0 ||
+        a->side_to_move != b->side_to_move ||
+        a->castle_rights != b->castle_rights ||
+        a->en_passant != b->en_passant ||
+        a->halfmove_clock != b->halfmove_clock ||
+        a->fullmove_number != b->fullmove_number) {
+        return 0;
+    }
+    for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+        if ((all_rules || (a->castle_rights & (1 << i))) &&
+            !castle_rules_equal(&a->castle_rules[i], &b->castle_rules[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Rebuilds what make_move() updated in place from scratch and compares
+static const char *verify_position(const Position *pos)
+{
+    uint64_t seen = 0;
+    for (int i = 0; i < 12; i++) {
+        if (seen & pos->bitboards[i]) {
+            return "two pieces on one square";
+        }
+        seen |= pos->bitboards[i];
+    }
+    if (count_bits(pos->bitboards[WHITE_KING_INDEX]) != 1 ||
+        count_bits(pos->bitboards[BLACK_KING_INDEX]) != 1) {
+        return "king count";
+    }
+    if (pos->en_passant != NO_SQUARE &&
+        find_piece_by_position(pos, pos->en_passant) >= 0) {
+        return "occupied en passant square";
+    }
+
+    char fen[MAX_FEN_LENGTH];
+    Position rebuilt;
+    if (position_to_fen(pos, fen, sizeof(fen)) != 0 ||
+        position_from_fen(&rebuilt, fen) != 0) {
+        return "FEN round trip failed";
+    }
+    if (!positions_equal(pos, &rebuilt, 0)) {
+        return "differs from its FEN";
+    }
+    return NULL;
+}
+
+static int play_random_game(uint64_t seed, uint64_t *positions)
+{
+    uint64_t state = seed ? seed : 1;
+    Position pos;
+    Position history[RANDOM_GAME_PLIES];
+    MoveUndo undos[RANDOM_GAME_PLIES];
+    char fen[MAX_FEN_LENGTH];
+    int ply;
+
+    // Every other game starts from a random Chess960 setup
+    if (seed % 2) {
+        setup_chess960(&pos, next_random(&state) % 960);
+    } else {
+        set_start_position(&pos);
+    }
+
+    for (ply = 0; ply < RANDOM_GAME_PLIES; ply++) {
+        Move moves[MAX_MOVES];
+        int count = generate_legal_moves(&pos, moves);
+        if (count == 0) {
+            break;
+        }
+        Move move = moves[next_random(&state) % count];
+        history[ply] = pos;
+        make_move(&pos, move, &undos[ply]);
+        (*positions)++;
+
+        const char *error = verify_position(&pos);
+        if (error) {
+            char notation[6];
+            move_to_notation(move, notation);
+            position_to_fen(&history[ply], fen, sizeof(fen));
+            printf("seed %llu ply %d: %s after %s from %s\n",
+                   (unsigned long long) seed, ply, error, notation, fen);
+            return 1;
+        }
+    }
+
+    // Take everything back, each step must give the exact earlier position
+    while (ply-- > 0) {
+        unmake_move(&pos, &undos[ply]);
+        if (!positions_equal(&pos, &history[ply], 1)) {
+            char notation[6];
+            move_to_notation(undos[ply].move, notation);
+            position_to_fen(&history[ply], fen, sizeof(fen));
+            printf("seed %llu ply %d: unmaking %s does not restore %s\n",
+                   (unsigned long long) seed, ply, notation, fen);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void run_random_game(int index, void *arg)
+{
+    RandomRun *run = arg;
+    uint64_t positions = 0;
+    int failed = play_random_game(run->seed + index, &positions);
+
+    atomic_fetch_add(&run->positions, positions);
+    atomic_fetch_add(&run->failed, failed);
+}
+
+static int run_random(ThreadPool *pool, int games, uint64_t seed)
+{
+    RandomRun run = {seed, 0, 0};
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parallel_for(pool, games, 1, run_random_game, &run);
+
+    int failed = atomic_load(&run.failed);
+    printf("%d/%d random games round-tripped, %llu positions checked on %d "
+           "threads in %.0f ms (seed %llu)\n",
+           games - failed, games,
+           (unsigned long long) atomic_load(&run.positions),
+           get_pool_threads(pool), elapsed_ms(start),
+           (unsigned long long) seed);
+    return failed ? 1 : 0;
+}
+
+static void empty_task(int index, void *arg)
+{
+    (void) index;
+    (void) arg;
+}
+
+static void slow_task(void *arg)
+{
+    struct timespec pause = {0, 1000000};
+    atomic_fetch_add((atomic_int *) arg, 1);
+    nanosleep(&pause, NULL);
+}
+
+// Cancelling right after submitting must skip the tasks no thread has
+// started yet and still leave nothing pending
+static int check_cancel(ThreadPool *pool)
+{
+    Task tasks[CANCEL_TASKS];
+    TaskGroup group;
+    atomic_int ran;
+
+    atomic_init(&ran, 0);
+    init_task_group(&group);
+    for (int i = 0; i < CANCEL_TASKS; i++) {
+        submit_task(pool, &tasks[i], slow_task, &ran, &group);
+    }
+    cancel_task_group(&group);
+    wait_task_group(pool, &group);
+
+    int started = atomic_load(&ran);
+    if (!is_task_group_cancelled(&group) || started >= CANCEL_TASKS ||
+        atomic_load(&group.pending) != 0) {
+        printf("FAIL cancel on %d threads: %d/%d tasks ran, %d pending\n",
+               get_pool_threads(pool), started, CANCEL_TASKS,
+               atomic_load(&group.pending));
+        return 1;
+    }
+    return 0;
+}
+
+// Per task cost with nothing to do, and perft speedup from 1 to max_threads.
+// Cancellation is checked on every pool size along the way.
+static int run_pool_bench(int max_threads)
+{
+    const PerftCase *test = &perft_suite[3];
+    double single_thread_ms = 0.0;
+    Position pos;
+    position_from_fen(&pos, test->fen);
+
+    printf("threads  ns/empty task  perft %d ms  speedup\n", test->depth);
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool *pool = create_thread_pool(threads);
+        struct timespec start;
+        if (!pool) {
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        parallel_for(pool, BENCH_TASKS, 1, empty_task, NULL);
+        double task_ns = elapsed_ms(start) * 1000000.0 / BENCH_TASKS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t nodes = parallel_perft(pool, &pos, test->depth);
+        double perft_ms = elapsed_ms(start);
+        if (threads == 1) {
+            single_thread_ms = perft_ms;
+        }
+        int cancel_failed = check_cancel(pool);
+        destroy_thread_pool(pool);
+        if (cancel_failed) {
+            return 1;
+        }
+
+        if (nodes != test->nodes) {
+            printf("FAIL %s: %llu nodes on %d threads\n", test->name,
+                   (unsigned long long) nodes, threads);
+            return 1;
+        }
+        printf("%7d  %13.0f  %10.0f  %6.2fx\n", threads, task_ns, perft_ms,
+               single_thread_ms / perft_ms);
+    }
+    return 0;
+}
+
+static int run_suite(ThreadPool *pool)
+{
+    int count = sizeof(perft_suite) / sizeof(perft_suite[0]);
+    int failed = 0;
+    uint64_t total_nodes = 0;
+    struct timespec suite_start;
+    clock_gettime(CLOCK_MONOTONIC, &suite_start);
+
+    for (int i = 0; i < count; i++) {
+        const PerftCase *test = &perft_suite[i];
+        Position pos;
+        struct timespec start;
+
+        if (position_from_fen(&pos, test->fen) != 0) {
+            printf("FAIL %-24s invalid FEN\n", test->name);
+            failed++;
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t nodes = parallel_perft(pool, &pos, test->depth);
+        double ms = elapsed_ms(start);
+        total_nodes += nodes;
+
+        if (nodes != test->nodes) {
+            printf("FAIL %-24s depth %d: %llu nodes, expected %llu\n",
+                   test->name, test->depth, (unsigned long long) nodes,
+                   (unsigned long long) test->nodes);
+            failed++;
+        } else {
+            printf("ok   %-24s depth %d: %llu nodes in %.0f ms\n", test->name,
+                   test->depth, (unsigned long long) nodes, ms);
+        }
+    }
+
+    int rejected_count = sizeof(rejected_fens) / sizeof(rejected_fens[0]);
+    for (int i = 0; i < rejected_count; i++) {
+        Position pos;
+        if (position_from_fen(&pos, rejected_fens[i].fen) == 0) {
+            printf("FAIL %-24s accepted %s\n", rejected_fens[i].name,
+                   rejected_fens[i].fen);
+            failed++;
+        }
+    }
+    count += rejected_count;
+
+    double ms = elapsed_ms(suite_start);
+    printf("%d/%d positions correct, %llu nodes in %.0f ms (%.0f knps, %d "
+           "threads)\n",
+           count - failed, count, (unsigned long long) total_nodes, ms,
+           ms > 0 ? total_nodes / ms : 0.0, get_pool_threads(pool));
+    return failed ? 1 : 0;
+}
+
+static int collect_positions(PositionList *list, Position *pos, int depth)
+{
+    if (list->count == list->capacity) {
+        // realloc() cannot be used, it does not keep the 64 byte alignment
+        int capacity = list->capacity ? list->capacity * 2 : 1024;
+        Position *positions =
+            aligned_alloc(_Alignof(Position), capacity * sizeof(Position));
+        if (!positions) {
+            return -1;
+        }
+        if (list->count) {
+            memcpy(positions, list->positions, list->count * sizeof(Position));
+        }
+        free(list->positions);
+        list->positions = positions;
+        list->capacity = capacity;
+    }
+    list->positions[list->count++] = *pos;
+    if (depth == 0) {
+        return 0;
+    }
+
+    Move moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        make_move(pos, moves[i], &undo);
+        int result = collect_positions(list, pos, depth - 1);
+        unmake_move(pos, &undo);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+// What generate_quiet_checks() replaces: every legal move is generated, the
+// quiet ones are made and tested for check
+static int filter_quiet_checks(Position *pos, Move moves[MAX_MOVES])
+{
+    Move legal[MAX_MOVES];
+    int count = generate_legal_moves(pos, legal);
+    char color = pos->side_to_move;
+    uint64_t enemy_board = get_color_board(pos, color == 'w' ? 'b' : 'w');
+    int checks = 0;
+
+    for (int i = 0; i < count; i++) {
+        int from = get_move_from(legal[i]);
+        int to = get_move_to(legal[i]);
+        char symbol = get_pieces()[find_piece_by_position(pos, from)].symbol;
+        int is_pawn = symbol == 'P' || symbol == 'p';
+        if (get_move_promotion(legal[i]) != NO_PROMOTION ||
+            is_bit_set(enemy_board, to) || (is_pawn && from % 8 != to % 8)) {
+            continue;
+        }
+        MoveUndo undo;
+        make_move(pos, legal[i], &undo);
+        if (is_check(pos, color)) {
+            moves[checks++] = legal[i];
+        }
+        unmake_move(pos, &undo);
+    }
+    return checks;
+}
+
+static int compare_moves(const void *a, const void *b)
+{
+    return (int) *(const Move *) a - (int) *(const Move *) b;
+}
+
+static double time_check_generator(PositionList *list,
+                                   int (*generate)(Position *, Move *),
+                                   uint64_t *checks)
+{
+    Move moves[MAX_MOVES];
+    struct timespec start;
+
+    *checks = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < CHECK_BENCH_ROUNDS; round++) {
+        for (int i = 0; i < list->count; i++) {
+            *checks += generate(&list->positions[i], moves);
+        }
+    }
+    return elapsed_ms(start);
+}
+
+// Compares generate_quiet_checks() with the filter on every position a few
+// plies into the suite, then times both
+static int run_check_bench(void)
+{
+    PositionList list = {NULL, 0, 0};
+    int count = sizeof(perft_suite) / sizeof(perft_suite[0]);
+    int failed = 0;
+
+    for (int i = 0; i < count; i++) {
+        Position pos;
+        position_from_fen(&pos, perft_suite[i].fen);
+        if (collect_positions(&list, &pos, CHECK_BENCH_DEPTH) != 0) {
+            printf("Failed to allocate the benchmark positions\n");
+            free(list.positions);
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < list.count; i++) {
+        Move expected[MAX_MOVES];
+        Move generated[MAX_MOVES];
+        int expected_count = filter_quiet_checks(&list.positions[i], expected);
+        int generated_count =
+            generate_quiet_checks(&list.positions[i], generated);
+        qsort(expected, expected_count, sizeof(Move), compare_moves);
+        qsort(generated, generated_count, sizeof(Move), compare_moves);
+
+        if (expected_count != generated_count ||
+            memcmp(expected, generated, expected_count * sizeof(Move)) != 0) {
+            char fen[MAX_FEN_LENGTH];
+            position_to_fen(&list.positions[i], fen, sizeof(fen));
+            printf("FAIL quiet checks: %d generated, %d expected in %s\n",
+                   generated_count, expected_count, fen);
+            failed++;
+        }
+    }
+
+    uint64_t filter_checks, generator_checks;
+    double filter_ms =
+        time_check_generator(&list, filter_quiet_checks, &filter_checks);
+    double generator_ms =
+        time_check_generator(&list, generate_quiet_checks, &generator_checks);
+    int positions = list.count * CHECK_BENCH_ROUNDS;
+
+    printf("%d/%d positions agree, %llu quiet checks per round\n",
+           list.count - failed, list.count,
+           (unsigned long long) generator_checks / CHECK_BENCH_ROUNDS);
+    printf("filter     %8.0f positions/s\n", positions * 1000.0 / filter_ms);
+    printf("generator  %8.0f positions/s (%.2fx)\n",
+           positions * 1000.0 / generator_ms, filter_ms / generator_ms);
+    free(list.positions);
+    return failed ? 1 : 0;
+}
+
+// Random games from the start position, the worst case for the index
+// model since every legal move is equally likely. Game g is at g * plies.
+typedef struct {
+    Position start;
+    int games;
+    Move *moves;
+    Move *decoded;
+    int *lengths;
+    uint8_t *data;
+    EncodedGame *encoded;
+} CodecBench;
+
+static void play_codec_games(CodecBench *bench, uint64_t seed)
+{
+    for (int g = 0; g < bench->games; g++) {
+        uint64_t state = seed + g ? seed + g : 1;
+        Position pos = bench->start;
+        Move *moves = bench->moves + (size_t) g * RANDOM_GAME_PLIES;
+        int ply;
+
+        for (ply = 0; ply < RANDOM_GAME_PLIES; ply++) {
+            Move legal[MAX_MOVES];
+            int count = generate_legal_moves(&pos, legal);
+            if (count == 0) {
+                break;
+            }
+            MoveUndo undo;
+            moves[ply] = legal[next_random(&state) % count];
+            make_move(&pos, moves[ply], &undo);
+        }
+        bench->lengths[g] = ply;
+    }
+}
+
+static int count_wrong_games(const CodecBench *bench)
+{
+    int wrong = 0;
+    for (int g = 0; g < bench->games; g++) {
+        const Move *moves = bench->moves + (size_t) g * RANDOM_GAME_PLIES;
+        wrong += bench->encoded[g].move_count != bench->lengths[g] ||
+                 memcmp(bench->encoded[g].moves, moves,
+                        bench->lengths[g] * sizeof(Move)) != 0;
+    }
+    return wrong;
+}
+
+static int time_codec(ThreadPool *pool, CodecBench *bench, uint64_t seed)
+{
+    const int max_bytes = MAX_ENCODED_GAME_BYTES(RANDOM_GAME_PLIES);
+    uint64_t total_moves = 0;
+    uint64_t total_bytes = 0;
+    int failed = 0;
+    struct timespec start;
+
+    play_codec_games(bench, seed);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int g = 0; g < bench->games; g++) {
+        size_t offset = (size_t) g * RANDOM_GAME_PLIES;
+        uint8_t *out = bench->data + (size_t) g * max_bytes;
+        int size = encode_game(&bench->start, bench->moves + offset,
+                               bench->lengths[g], out, max_bytes);
+        if (size < 0) {
+            printf("FAIL game %d could not be encoded\n", g);
+            return 1;
+        }
+        bench->encoded[g] =
+            (EncodedGame) {&bench->start, out, size, bench->decoded + offset,
+                           RANDOM_GAME_PLIES, 0};
+        total_moves += bench->lengths[g];
+        total_bytes += size;
+    }
+    double encode_ms = elapsed_ms(start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int g = 0; g < bench->games; g++) {
+        EncodedGame *game = &bench->encoded[g];
+        game->move_count = decode_game(game->start, game->data, game->size,
+                                       game->moves, game->max_moves);
+    }
+    double decode_ms = elapsed_ms(start);
+    failed += count_wrong_games(bench);
+
+    memset(bench->decoded, 0,
+           (size_t) bench->games * RANDOM_GAME_PLIES * sizeof(Move));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    decode_games(pool, bench->encoded, bench->games);
+    double parallel_ms = elapsed_ms(start);
+    failed += count_wrong_games(bench);
+
+    printf("%d games, %llu moves, %.2f bytes per move (seed %llu)\n",
+           bench->games, (unsigned long long) total_moves,
+           (double) total_bytes / total_moves, (unsigned long long) seed);
+    printf("encode            %9.0f moves/s\n",
+           total_moves * 1000.0 / encode_ms);
+    printf("decode            %9.0f moves/s\n",
+           total_moves * 1000.0 / decode_ms);
+    printf("decode %2d threads %9.0f moves/s\n", get_pool_threads(pool),
+           total_moves * 1000.0 / parallel_ms);
+    if (failed) {
+        printf("FAIL %d decodes differ from the games played\n", failed);
+    }
+    return failed ? 1 : 0;
+}
+
+// Encodes random games, then decodes them on one thread and on the pool
+static int run_codec_bench(ThreadPool *pool, int games, uint64_t seed)
+{
+    size_t plies = (size_t) games * RANDOM_GAME_PLIES;
+    CodecBench bench;
+    int result = 1;
+
+    set_start_position(&bench.start);
+    bench.games = games;
+    bench.moves = malloc(plies * sizeof(Move));
+    bench.decoded = malloc(plies * sizeof(Move));
+    bench.lengths = malloc(games * sizeof(int));
+    bench.data =
+        malloc((size_t) games * MAX_ENCODED_GAME_BYTES(RANDOM_GAME_PLIES));
+    bench.encoded = malloc(games * sizeof(EncodedGame));
+
+    if (bench.moves && bench.decoded && bench.lengths && bench.data &&
+        bench.encoded) {
+        result = time_codec(pool, &bench, seed);
+    } else {
+        printf("Failed to allocate %d games\n", games);
+    }
+    free(bench.moves);
+    free(bench.decoded);
+    free(bench.lengths);
+    free(bench.data);
+    free(bench.encoded);
+    return result;
+}
+
+static int get_thread_count(int argc, char *argv[], int index)
+{
+    int threads = argc > index ? atoi(argv[index])
+                               : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    return threads > MAX_POOL_THREADS ? MAX_POOL_THREADS : threads;
+}
+
+int main(int argc, char *argv[])
+{
+    ThreadPool *pool = NULL;
+    int result;
+
+    if (argc < 2 || strcmp(argv[1], "--suite") == 0) {
+        // perft --suite [threads]: reference node counts
+        pool = create_thread_pool(get_thread_count(argc, argv, 2));
+        if (!pool) {
+            return 1;
+        }
+        result = run_suite(pool);
+        destroy_thread_pool(pool);
+        return result;
+    }
+
+    // perft --random <games> [seed] [threads]: make/unmake round trips
+    if (strcmp(argv[1], "--random") == 0) {
+        int games = argc > 2 ? atoi(argv[2]) : 1000;
+        uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : time(NULL);
+        if (games < 1 ||
+            !(pool = create_thread_pool(get_thread_count(argc, argv, 4)))) {
+            printf("Usage: %s --random <games> [seed] [threads]\n", argv[0]);
+            return 1;
+        }
+        result = run_random(pool, games, seed);
+        destroy_thread_pool(pool);
+        return result;
+    }
+
+    // perft --bench-pool [max_threads]: thread pool overhead and scaling
+    if (strcmp(argv[1], "--bench-pool") == 0) {
+        return run_pool_bench(argc > 2 ? get_thread_count(argc, argv, 2)
+                                       : MAX_POOL_THREADS);
+    }
+
+    // perft --bench-codec [games] [seed] [threads]: game storage round trip
+    if (strcmp(argv[1], "--bench-codec") == 0) {
+        int games = argc > 2 ? atoi(argv[2]) : 200;
+        uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : time(NULL);
+        if (games < 1 ||
+            !(pool = create_thread_pool(get_thread_count(argc, argv, 4)))) {
+            printf("Usage: %s --bench-codec [games] [seed] [threads]\n",
+                   argv[0]);
+            return 1;
+        }
+        result = run_codec_bench(pool, games, seed);
+        destroy_thread_pool(pool);
+        return result;
+    }
+
+    // perft --bench-checks: quiet check generator against the filter
+    if (strcmp(argv[1], "--bench-checks") == 0) {
+        return run_check_bench();
+    }
+
+    // perft <depth> [fen]: divide output for a single position
+    int depth = atoi(argv[1]);
+    const char *fen = argc > 2 ? argv[2] : START_FEN;
+    Position pos;
+    if (depth < 1 || position_from_fen(&pos, fen) != 0) {
+        printf("Usage: %s [--suite [threads] | --random <games> [seed] "
+               "[threads] | --bench-pool [max_threads] | --bench-checks | "
+               "--bench-codec [games] [seed] [threads] | <depth> [fen]]\n",
+               argv[0]);
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t nodes = divide(&pos, depth);
+    printf("\nNodes searched: %llu (%.0f ms)\n", (unsigned long long) nodes,
+           elapsed_ms(start));
+    return 0;
+}
@@ -7,38 +7,28 @@
 #include <stdlib.h>
 #include <string.h>
 
-uint64_t WHITE_PAWNS = 0x000000000000FF00ULL;
-uint64_t BLACK_PAWNS = 0x00FF000000000000ULL;
-
-uint64_t WHITE_ROOKS = 0x0000000000000081ULL;
-uint64_t BLACK_ROOKS = 0x8100000000000000ULL;
-
-uint64_t WHITE_KNIGHTS = 0x0000000000000042ULL;
-uint64_t BLACK_KNIGHTS = 0x4200000000000000ULL;
-
-uint64_t WHITE_BISHOPS = 0x0000000000000024ULL;
-uint64_t BLACK_BISHOPS = 0x2400000000000000ULL;
-
-uint64_t WHITE_QUEEN = 0x0000000000000008ULL;
-uint64_t BLACK_QUEEN = 0x0800000000000000ULL;
-
-uint64_t WHITE_KING = 0x0000000000000010ULL;
-uint64_t BLACK_KING = 0x1000000000000000ULL;
-
-Piece pieces[12] = {
-    {&WHITE_PAWNS, 'P', 'w', 1},
-    {&BLACK_PAWNS, 'p', 'b', 1},
-    {&WHITE_ROOKS, 'R', 'w', 5},
-    {&BLACK_ROOKS, 'r', 'b', 5},
-    {&WHITE_KNIGHTS, 'N', 'w', 3},
-    {&BLACK_KNIGHTS, 'n', 'b', 3},
-    {&WHITE_BISHOPS, 'B', 'w', 3},
-    {&BLACK_BISHOPS, 'b', 'b', 3},
-    {&WHITE_QUEEN, 'Q', 'w', 9},
-    {&BLACK_QUEEN, 'q', 'b', 9},
+const Piece pieces[12] = {
+    {'P', 'w', 1},
+    {'p', 'b', 1},
+    {'R', 'w', 5},
+    {'r', 'b', 5},
+    {'N', 'w', 3},
+    {'n', 'b', 3},
+    {'B', 'w', 3},
+    {'b', 'b', 3},
+    {'Q', 'w', 9},
+    {'q', 'b', 9},
     // Value of zero for king may have to be changed for minimax algo
-    {&WHITE_KING, 'K', 'w', 0},
-    {&BLACK_KING, 'k', 'b', 0},
+    {'K', 'w', 0},
+    {'k', 'b', 0},
+};
+
+// Standard start position, indexed like the pieces table
+const uint64_t start_bitboards[12] = {
+    0x000000000000FF00ULL, 0x00FF000000000000ULL, 0x0000000000000081ULL,
+    0x8100000000000000ULL, 0x0000000000000042ULL, 0x4200000000000000ULL,
+    0x0000000000000024ULL, 0x2400000000000000ULL, 0x0000000000000008ULL,
+    0x0800000000000000ULL, 0x0000000000000010ULL, 0x1000000000000000ULL,
 };
 
 int calculate_possible_moves(int position)
@@ -46,60 +36,76 @@ int calculate_possible_moves(int position)
     return position + 8;
 }
 
-uint64_t get_full_board(void)
+uint64_t get_full_board(const Position *pos)
 {
     uint64_t board = (uint64_t) 0;
     for (int i = 0; i < 12; i++) {
-        board |= *(pieces[i].pos_bb);
+        board |= pos->bitboards[i];
     }
     return board;
 }
 
-Piece *get_pieces(void)
+uint64_t get_color_board(const Position *pos, char color)
 {
-    return pieces;
+    uint64_t board = (uint64_t) 0;
+    for (int i = 0; i < 12; i++) {
+        if (pieces[i].color == color) {
+            board |= pos->bitboards[i];
+        }
+    }
+    return board;
 }
 
-int is_bit_set(uint64_t bb, int position)
+const Piece *get_pieces(void)
 {
-    uint64_t mask = (uint64_t) 1 << position;
-    return (bb & mask) ? 1 : 0;
+    return pieces;
 }
 
-int is_enemy(Piece *piece, int position)
+const uint64_t *get_start_bitboards(void)
 {
-    Piece *other_piece = find_piece_by_position(position);
+    return start_bitboards;
+}
 
-    if (piece->color != other_piece->color) {
-        return 1;
-    }
-    return 0;
+int is_bit_set(uint64_t bb, int position)
+{
+    uint64_t mask = (uint64_t) 1 << position;
+    return (bb & mask) ? 1 : 0;
 }
 
-// Deze functie generiek maken -> zie print_bitboard()
-Piece *find_piece_by_position(int position)
+// Returns the index in the pieces table, or -1 for an empty square
+int find_piece_by_position(const Position *pos, int position)
 {
     if (position < 0 || position > 63) {
-        return NULL;
+        return -1;
     }
-    Piece *pieces = get_pieces();
-    uint64_t mask = ((int64_t) 1 << position);
+    uint64_t mask = ((uint64_t) 1 << position);
     for (int i = 0; i < 12; i++) {
-        if (*(pieces[i].pos_bb) & mask) {
-            return &pieces[i];
+        if (pos->bitboards[i] & mask) {
+            return i;
         }
     }
-    return NULL;
+    return -1;
 }
 
-uint64_t find_possible_pawn_moves(Piece *piece, Square input_square,
-                                  int position, uint64_t full_board,
-                                  GameState *game_state)
+uint64_t find_possible_pawn_moves(const Position *pos, const Piece *piece,
+                                  Square input_square, int position,
+                                  uint64_t full_board)
 {
     uint64_t possible_moves = (uint64_t) 0;
+    char enemy_color = piece->color == 'w' ? 'b' : 'w';
+    uint64_t enemy_board = get_color_board(pos, enemy_color);
+
+    // The en passant square is empty, count it as an enemy so that it goes
+    // through the normal capture test. Only the pawns of the side that did
+    // not just double push may use it.
+    int en_passant_row = piece->color == 'w' ? 5 : 2;
+    if (pos->en_passant != NO_SQUARE &&
+        pos->en_passant / 8 == en_passant_row) {
+        set_bit(&enemy_board, pos->en_passant);
+    }
 
     if (piece->symbol == 'P') {
-        if (input_square.row < 8) {
+        if (input_square.row < 7) {
             if (!(is_bit_set(full_board, (position + 8)))) {
                 possible_moves |= ((uint64_t) 1 << (position + 8));
             }
@@ -110,27 +116,12 @@ uint64_t find_possible_pawn_moves(Piece *piece, Square input_square,
                     possible_moves |= ((uint64_t) 1 << (position + 16));
                 }
             }
-            if (input_square.row == 4) {
-                // Implement en passant
-                if (game_state->last_moved_piece == 'p' &&
-                    abs(input_square.file -
-                        (game_state->last_move[2] - FILE_OFFSET)) == 1 &&
-                    game_state->last_move[3] == '5') {
-                    int new_pos =
-                        8 - (input_square.file -
-                             (game_state->last_move[2] - FILE_OFFSET));
-                    possible_moves |= ((uint64_t) 1 << (position + new_pos));
-                    game_state->play_en_passant = 1;
-                }
-            }
             if (input_square.file < 7 &&
-                is_bit_set(full_board, (position + 9)) &&
-                is_enemy(piece, (position + 9))) {
+                is_bit_set(enemy_board, (position + 9))) {
                 possible_moves |= ((uint64_t) 1 << (position + 9));
             }
             if (input_square.file > 0 &&
-                is_bit_set(full_board, (position + 7)) &&
-                is_enemy(piece, (position + 7))) {
+                is_bit_set(enemy_board, (position + 7))) {
                 possible_moves |= ((uint64_t) 1 << (position + 7));
             }
         }
@@ -145,27 +136,12 @@ uint64_t find_possible_pawn_moves(Piece *piece, Square input_square,
                     possible_moves |= ((uint64_t) 1 << (position - 16));
                 }
             }
-            if (input_square.row == 3) {
-                // Implement en passant
-                if (game_state->last_moved_piece == 'P' &&
-                    abs(input_square.file -
-                        (game_state->last_move[2] - FILE_OFFSET)) == 1 &&
-                    game_state->last_move[3] == '4') {
-                    int new_pos =
-                        8 + (input_square.file -
-                             (game_state->last_move[2] - FILE_OFFSET));
-                    possible_moves |= ((uint64_t) 1 << (position - new_pos));
-                    game_state->play_en_passant = 1;
-                }
-            }
             if (input_square.file < 7 &&
-                is_bit_set(full_board, (position - 7)) &&
-                is_enemy(piece, (position - 7))) {
+                is_bit_set(enemy_board, (position - 7))) {
                 possible_moves |= ((uint64_t) 1 << (position - 7));
             }
             if (input_square.file > 0 &&
-                is_bit_set(full_board, (position - 9)) &&
-                is_enemy(piece, (position - 9))) {
+                is_bit_set(enemy_board, (position - 9))) {
                 possible_moves |= ((uint64_t) 1 << (position - 9));
             }
         }
@@ -189,7 +165,7 @@ int check_diag_move(int position, int next_pos)
 }
 
 void find_diagonal_moves(int position, uint64_t full_board,
-                         uint64_t *possible_moves, Piece *piece,
+                         uint64_t *possible_moves, uint64_t own_board,
                          int max_counter)
 {
     int directions[4] = {7, 9, -7, -9};
@@ -200,7 +176,7 @@ void find_diagonal_moves(int position, uint64_t full_board,
         while (check_diag_move(old_pos, next_pos) && counter <= max_counter) {
             counter++;
             if (is_bit_set(full_board, next_pos)) {
-                if (is_enemy(piece, next_pos)) {
+                if (!(is_bit_set(own_board, next_pos))) {
                     *possible_moves |= (uint64_t) 1 << next_pos;
                 }
                 break;
@@ -212,12 +188,12 @@ void find_diagonal_moves(int position, uint64_t full_board,
     }
 }
 
-uint64_t find_possible_bishop_moves(Piece *piece, int position,
+uint64_t find_possible_bishop_moves(uint64_t own_board, int position,
                                     uint64_t full_board)
 {
     int max_counter = 8;
     uint64_t possible_moves = (uint64_t) 0;
-    find_diagonal_moves(position, full_board, &possible_moves, piece,
+    find_diagonal_moves(position, full_board, &possible_moves, own_board,
                         max_counter);
     return possible_moves;
 }
@@ -243,7 +219,7 @@ int check_horizontal_move(int position, int next_pos)
 }
 
 void find_orthogonal_moves(int position, uint64_t full_board,
-                           uint64_t *possible_moves, Piece *piece,
+                           uint64_t *possible_moves, uint64_t own_board,
                            int max_counter)
 {
     int hor_dir[2] = {-1, 1};
@@ -255,7 +231,7 @@ void find_orthogonal_moves(int position, uint64_t full_board,
                counter <= max_counter) {
             counter++;
             if (is_bit_set(full_board, next_pos)) {
-                if (is_enemy(piece, next_pos)) {
+                if (!(is_bit_set(own_board, next_pos))) {
                     *possible_moves |= (uint64_t) 1 << next_pos;
                 }
                 break;
@@ -274,7 +250,7 @@ void find_orthogonal_moves(int position, uint64_t full_board,
         while (check_vertical_move(next_pos) && counter <= max_counter) {
             counter++;
             if (is_bit_set(full_board, next_pos)) {
-                if (is_enemy(piece, next_pos)) {
+                if (!(is_bit_set(own_board, next_pos))) {
                     *possible_moves |= (uint64_t) 1 << next_pos;
                 }
                 break;
@@ -286,30 +262,29 @@ void find_orthogonal_moves(int position, uint64_t full_board,
     }
 }
 
-uint64_t find_possible_rook_moves(Piece *piece, int position,
+uint64_t find_possible_rook_moves(uint64_t own_board, int position,
                                   uint64_t full_board)
 {
     int max_counter = 8;
     uint64_t possible_moves = (uint64_t) 0;
-    find_orthogonal_moves(position, full_board, &possible_moves, piece,
+    find_orthogonal_moves(position, full_board, &possible_moves, own_board,
                           max_counter);
     return possible_moves;
 }
 
-uint64_t find_possible_queen_moves(Piece *piece, int position,
+uint64_t find_possible_queen_moves(uint64_t own_board, int position,
                                    uint64_t full_board)
 {
     int max_counter = 8;
     uint64_t possible_moves = (uint64_t) 0;
-    find_diagonal_moves(position, full_board, &possible_moves, piece,
+    find_diagonal_moves(position, full_board, &possible_moves, own_board,
                         max_counter);
-    find_orthogonal_moves(position, full_board, &possible_moves, piece,
+    find_orthogonal_moves(position, full_board, &possible_moves, own_board,
                           max_counter);
     return possible_moves;
 }
 
-uint64_t find_possible_knight_moves(Piece *piece, int position,
-                                    uint64_t full_board)
+uint64_t find_possible_knight_moves(uint64_t own_board, int position)
 {
     uint64_t possible_moves = (uint64_t) 0;
     int ver_dir[2] = {-8, 8};
@@ -320,8 +295,7 @@ uint64_t find_possible_knight_moves(Piece *piece, int position,
             for (int j = 0; j < 2; j++) {
                 int new_pos = pos_1 + hor_step[j];
                 if (check_horizontal_move(pos_1, new_pos)) {
-                    if (is_bit_set(full_board, new_pos) &&
-                        !(is_enemy(piece, new_pos))) {
+                    if (is_bit_set(own_board, new_pos)) {
                         continue;
                     }
                     possible_moves |= (uint64_t) 1 << new_pos;
@@ -333,8 +307,7 @@ uint64_t find_possible_knight_moves(Piece *piece, int position,
             for (int j = 0; j < 2; j++) {
                 int new_hor = pos_2 + ver_dir[j];
                 if (check_vertical_move(new_hor)) {
-                    if (is_bit_set(full_board, new_hor) &&
-                        !(is_enemy(piece, new_hor))) {
+                    if (is_bit_set(own_board, new_hor)) {
                         continue;
                     }
                     possible_moves |= (uint64_t) 1 << new_hor;
@@ -345,98 +318,223 @@ uint64_t find_possible_knight_moves(Piece *piece, int position,
     return possible_moves;
 }
 
-int is_castle_possible(int rook_index, int king_index, uint64_t full_board)
+uint64_t find_pawn_attacks(char color, int position)
 {
-    if (king_index > rook_index) {
-        for (int i = rook_index + 1; i < king_index; i++) {
-            if (is_bit_set(full_board, i)) {
-                return 0;
-            }
+    uint64_t attacks = (uint64_t) 0;
+    int file = position % 8;
+    int forward = color == 'w' ? 8 : -8;
+    int next_row = position + forward;
+
+    if (next_row < 0 || next_row > 63) {
+        return attacks;
+    }
+    if (file > 0) {
+        set_bit(&attacks, next_row - 1);
+    }
+    if (file < 7) {
+        set_bit(&attacks, next_row + 1);
+    }
+    return attacks;
+}
+
+// Squares attacked by the piece of type piece_index standing on position
+uint64_t find_piece_attacks(int piece_index, int position, uint64_t own_board,
+                            uint64_t full_board)
+{
+    uint64_t attacks = (uint64_t) 0;
+
+    switch (pieces[piece_index].symbol) {
+    case 'P':
+    case 'p':
+        // Pushes never attack, diagonals do even when empty
+        attacks = find_pawn_attacks(pieces[piece_index].color, position);
+        break;
+    case 'N':
+    case 'n':
+        attacks = find_possible_knight_moves(own_board, position);
+        break;
+    case 'B':
+    case 'b':
+        attacks = find_possible_bishop_moves(own_board, position, full_board);
+        break;
+    case 'R':
+    case 'r':
+        attacks = find_possible_rook_moves(own_board, position, full_board);
+        break;
+    case 'Q':
+    case 'q':
+        attacks = find_possible_queen_moves(own_board, position, full_board);
+        break;
+    case 'K':
+    case 'k':
+        // Single steps only, castling cannot capture
+        find_diagonal_moves(position, full_board, &attacks, own_board, 1);
+        find_orthogonal_moves(position, full_board, &attacks, own_board, 1);
+        break;
+    }
+    return attacks;
+}
+
+// Attacks of color on a given occupancy. Pieces not on full_board are left
+// out, which lets callers look through a piece without touching the position.
+uint64_t find_attacks_with_board(const Position *pos, char color,
+                                 uint64_t full_board)
+{
+    uint64_t own_board = get_color_board(pos, color) & full_board;
+    uint64_t attacks = (uint64_t) 0;
+
+    for (int i = 0; i < 12; i++) {
+        if (pieces[i].color != color) {
+            continue;
         }
-    } else {
-        for (int i = king_index + 1; i < rook_index; i++) {
-            if (is_bit_set(full_board, i)) {
-                return 0;
-            }
+        uint64_t piece_bb = pos->bitboards[i] & full_board;
+        while (piece_bb) {
+            int position = get_lowest_bit_index(piece_bb);
+            attacks |= find_piece_attacks(i, position, own_board, full_board);
+            piece_bb &= piece_bb - 1;
         }
     }
-    return 1;
+    return attacks;
 }
 
-uint64_t find_possible_king_moves(Piece *piece, int position,
-                                  uint64_t full_board, GameState *game_state)
+uint64_t find_attacked_squares(const Position *pos, char color)
 {
-    char color_moving = piece->color;
-    TeamState *state =
-        color_moving == 'w' ? game_state->white_state : game_state->black_state;
+    return find_attacks_with_board(pos, color, get_full_board(pos));
+}
 
-    int max_counter = 1;
-    uint64_t possible_moves = (uint64_t) 0;
-    find_diagonal_moves(position, full_board, &possible_moves, piece,
-                        max_counter);
-    find_orthogonal_moves(position, full_board, &possible_moves, piece,
-                          max_counter);
+void find_attack_counts(const Position *pos, char color, uint8_t counts[64])
+{
+    uint64_t full_board = get_full_board(pos);
 
-    int king_index =
-        color_moving == 'w' ? WHITE_KING_POSITION : BLACK_KING_POSITION;
-    if (state->short_castle_allowed && !(game_state->is_check)) {
-        int castle_position = color_moving == 'w' ? WHITE_SHORT_CASTLE_POSITION
-                                                  : BLACK_SHORT_CASTLE_POSITION;
-        int rook_index = color_moving == 'w' ? WHITE_SHORT_ROOK_POSITION
-                                             : BLACK_SHORT_ROOK_POSITION;
-        if (is_castle_possible(rook_index, king_index, full_board)) {
-            set_bit(&possible_moves, castle_position);
+    memset(counts, 0, 64);
+    for (int i = 0; i < 12; i++) {
+        if (pieces[i].color != color) {
+            continue;
+        }
+        uint64_t piece_bb = pos->bitboards[i];
+        while (piece_bb) {
+            int position = get_lowest_bit_index(piece_bb);
+            // No own board, squares of defended pieces count as well
+            uint64_t attacks =
+                find_piece_attacks(i, position, (uint64_t) 0, full_board);
+            while (attacks) {
+                counts[get_lowest_bit_index(attacks)]++;
+                attacks &= attacks - 1;
+            }
+            piece_bb &= piece_bb - 1;
         }
     }
+}
 
-    if (state->long_castle_allowed && !(game_state->is_check)) {
-        int castle_position = color_moving == 'w' ? WHITE_LONG_CASTLE_POSITION
-                                                  : BLACK_LONG_CASTLE_POSITION;
-        int rook_index = color_moving == 'w' ? WHITE_LONG_ROOK_POSITION
-                                             : BLACK_LONG_ROOK_POSITION;
+int find_castle_right(const Position *pos, char color, int from, int to)
+{
+    for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+        const CastleRule *rule = &pos->castle_rules[i];
+        if ((pos->castle_rights & (1 << i)) && rule->color == color &&
+            rule->king_from == from && rule->target == to) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int update_castle_rights(const Position *pos, int castle_rights, int from,
+                         int to)
+{
+    // Moving the king or a castling rook, or capturing on its square, loses
+    // the right for good
+    for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+        const CastleRule *rule = &pos->castle_rules[i];
+        if (from == rule->king_from || from == rule->rook_from ||
+            to == rule->king_from || to == rule->rook_from) {
+            castle_rights &= ~(1 << i);
+        }
+    }
+    return castle_rights;
+}
+
+uint64_t find_castle_moves(const Position *pos, char color, int position,
+                           uint64_t full_board)
+{
+    uint64_t possible_moves = (uint64_t) 0;
+    char enemy_color = color == 'w' ? 'b' : 'w';
 
-        if (is_castle_possible(rook_index, king_index, full_board)) {
-            set_bit(&possible_moves, castle_position);
+    for (int i = 0; i < CASTLE_RIGHTS_COUNT; i++) {
+        const CastleRule *rule = &pos->castle_rules[i];
+        if (!(pos->castle_rights & (1 << i)) || rule->color != color ||
+            rule->king_from != position || (full_board & rule->empty_mask)) {
+            continue;
+        }
+        // Leave the castling rook off the board so that an x-ray through it
+        // (possible in Chess960) is seen on the squares the king crosses
+        uint64_t without_rook = full_board;
+        unset_bit(&without_rook, rule->rook_from);
+        uint64_t attacks =
+            find_attacks_with_board(pos, enemy_color, without_rook);
+
+        if (!(attacks & rule->safe_mask)) {
+            set_bit(&possible_moves, rule->target);
         }
     }
     return possible_moves;
 }
 
-uint64_t find_possible_moves(Square input_square, Piece *piece,
-                             GameState *game_state)
+uint64_t find_possible_king_moves(const Position *pos, const Piece *piece,
+                                  int position, uint64_t full_board)
+{
+    int max_counter = 1;
+    uint64_t own_board = get_color_board(pos, piece->color);
+    uint64_t possible_moves = (uint64_t) 0;
+    find_diagonal_moves(position, full_board, &possible_moves, own_board,
+                        max_counter);
+    find_orthogonal_moves(position, full_board, &possible_moves, own_board,
+                          max_counter);
+    possible_moves |=
+        find_castle_moves(pos, piece->color, position, full_board);
+    return possible_moves;
+}
+
+uint64_t find_possible_moves(const Position *pos, Square input_square)
 {
     int position = get_position(input_square.file, input_square.row);
-    uint64_t full_board = get_full_board();
+    int piece_index = find_piece_by_position(pos, position);
+    if (piece_index < 0) {
+        return (uint64_t) 0;
+    }
+    const Piece *piece = &pieces[piece_index];
+    uint64_t full_board = get_full_board(pos);
+    uint64_t own_board = get_color_board(pos, piece->color);
     uint64_t possible_moves;
 
     switch (piece->symbol) {
     case 'P':
     case 'p':
-        possible_moves = find_possible_pawn_moves(piece, input_square, position,
-                                                  full_board, game_state);
+        possible_moves = find_possible_pawn_moves(pos, piece, input_square,
+                                                  position, full_board);
         break;
     case 'B':
     case 'b':
         possible_moves =
-            find_possible_bishop_moves(piece, position, full_board);
+            find_possible_bishop_moves(own_board, position, full_board);
         break;
     case 'R':
     case 'r':
-        possible_moves = find_possible_rook_moves(piece, position, full_board);
+        possible_moves =
+            find_possible_rook_moves(own_board, position, full_board);
         break;
     case 'Q':
     case 'q':
-        possible_moves = find_possible_queen_moves(piece, position, full_board);
+        possible_moves =
+            find_possible_queen_moves(own_board, position, full_board);
         break;
     case 'N':
     case 'n':
-        possible_moves =
-            find_possible_knight_moves(piece, position, full_board);
+        possible_moves = find_possible_knight_moves(own_board, position);
         break;
     case 'K':
     case 'k':
         possible_moves =
-            find_possible_king_moves(piece, position, full_board, game_state);
+            find_possible_king_moves(pos, piece, position, full_board);
         break;
     default:
         possible_moves = (uint64_t) 0;
@@ -446,13 +544,147 @@ uint64_t find_possible_moves(Square input_square, Piece *piece,
     return possible_moves;
 }
 
-Piece *get_piece_bb(char piece)
+void bitboards_to_board(const Position *pos, char board[8][8])
+{
+    for (int rank = 7; rank >= 0; rank--) {
+        for (int file = 0; file < 8; file++) {
+            int sq = rank * 8 + file;
+            uint64_t mask = (uint64_t) 1 << sq;
+            char piece = 0;
+
+            for (int i = 0; i < 12; i++) {
+                if (pos->bitboards[i] & mask) {
+                    piece = pieces[i].symbol;
+                }
+            }
+            board[rank][file] = piece;
+        }
+    }
+}
+
+int get_piece_index(char symbol)
 {
-    Piece *pieces = get_pieces();
     for (int i = 0; i < 12; i++) {
-        if (pieces[i].symbol == piece) {
-            return &pieces[i];
+        if (pieces[i].symbol == symbol) {
+            return i;
         }
     }
-    return NULL;
-}
\ No newline at end of file
+    return -1;
+}
+
+uint64_t span_between(int from, int to)
+{
+    uint64_t span = (uint64_t) 0;
+    int low = from < to ? from : to;
+    int high = from < to ? to : from;
+    for (int i = low; i <= high; i++) {
+        set_bit(&span, i);
+    }
+    return span;
+}
+
+void init_castle_rule(CastleRule *rule, char color, int king_file,
+                      int rook_file, int short_castle)
+{
+    int rank_offset = color == 'w' ? 0 : 56;
+    int standard = king_file == 4 && rook_file == (short_castle ? 7 : 0);
+
+    rule->color = color;
+    rule->king_from = rank_offset + king_file;
+    rule->king_to = rank_offset + (short_castle ? 6 : 2);
+    rule->rook_from = rank_offset + rook_file;
+    rule->rook_to = rank_offset + (short_castle ? 5 : 3);
+
+    // In Chess960 the king may already stand on (or next to) its destination,
+    // so the move is entered by clicking the rook instead
+    rule->target = standard ? rule->king_to : rule->rook_from;
+
+    rule->empty_mask = span_between(rule->king_from, rule->king_to) |
+                       span_between(rule->rook_from, rule->rook_to);
+    unset_bit(&rule->empty_mask, rule->king_from);
+    unset_bit(&rule->empty_mask, rule->rook_from);
+    rule->safe_mask = span_between(rule->king_from, rule->king_to);
+}
+
+int setup_chess960(Position *pos, int number)
+{
+    // Knight pairs over the five squares left after bishops and queen
+    // (Scharnagl numbering)
+    int knight_table[10][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2},
+                               {1, 3}, {1, 4}, {2, 3}, {2, 4}, {3, 4}};
+    char back_rank[8] = {0};
+
+    if (number < 0 || number > 959) {
+        return -1;
+    }
+
+    back_rank[(number % 4) * 2 + 1] = 'B';
+    number /= 4;
+    back_rank[(number % 4) * 2] = 'B';
+    number /= 4;
+
+    int queen_index = number % 6;
+    int knights = number / 6;
+    int empty_index = 0;
+    for (int file = 0; file < 8; file++) {
+        if (back_rank[file] != 0) {
+            continue;
+        }
+        if (empty_index == queen_index) {
+            back_rank[file] = 'Q';
+        }
+        empty_index++;
+    }
+
+    empty_index = 0;
+    for (int file = 0; file < 8; file++) {
+        if (back_rank[file] != 0) {
+            continue;
+        }
+        if (empty_index == knight_table[knights][0] ||
+            empty_index == knight_table[knights][1]) {
+            back_rank[file] = 'N';
+        }
+        empty_index++;
+    }
+
+    // Remaining three squares are always rook, king, rook
+    char remaining[3] = {'R', 'K', 'R'};
+    int rook_files[2];
+    int king_file = 0;
+    empty_index = 0;
+    for (int file = 0; file < 8; file++) {
+        if (back_rank[file] != 0) {
+            continue;
+        }
+        back_rank[file] = remaining[empty_index];
+        if (remaining[empty_index] == 'K') {
+            king_file = file;
+        } else {
+            rook_files[empty_index / 2] = file;
+        }
+        empty_index++;
+    }
+
+    set_start_position(pos);
+    for (int i = 0; i < 12; i++) {
+        pos->bitboards[i] &= start_bitboards[WHITE_PAWN_INDEX] |
+                             start_bitboards[BLACK_PAWN_INDEX];
+    }
+    for (int file = 0; file < 8; file++) {
+        int white_piece = get_piece_index(back_rank[file]);
+        int black_piece = get_piece_index(back_rank[file] + ('a' - 'A'));
+        set_bit(&pos->bitboards[white_piece], file);
+        set_bit(&pos->bitboards[black_piece], 56 + file);
+    }
+
+    init_castle_rule(&pos->castle_rules[WHITE_SHORT_CASTLE], 'w', king_file,
+                     rook_files[1], 1);
+    init_castle_rule(&pos->castle_rules[WHITE_LONG_CASTLE], 'w', king_file,
+                     rook_files[0], 0);
+    init_castle_rule(&pos->castle_rules[BLACK_SHORT_CASTLE], 'b', king_file,
+                     rook_files[1], 1);
+    init_castle_rule(&pos->castle_rules[BLACK_LONG_CASTLE], 'b', king_file,
+                     rook_files[0], 0);
+    return 0;
+}
@@ -1,46 +1,59 @@
 #ifndef PIECES_H
 #define PIECES_H
 
+#define WHITE_PAWN_INDEX 0
 #define WHITE_KING_INDEX 10
 #define WHITE_ROOK_INDEX 2
-#define WHITE_KING_POSITION 4
-#define WHITE_LONG_ROOK_POSITION 0
-#define WHITE_SHORT_ROOK_POSITION 7
-#define WHITE_SHORT_CASTLE_POSITION 6
-#define WHITE_LONG_CASTLE_POSITION 2
 
+#define BLACK_PAWN_INDEX 1
 #define BLACK_KING_INDEX 11
 #define BLACK_ROOK_INDEX 3
-#define BLACK_KING_POSITION 60
-#define BLACK_LONG_ROOK_POSITION 56
-#define BLACK_SHORT_ROOK_POSITION 63
-#define BLACK_SHORT_CASTLE_POSITION 62
-#define BLACK_LONG_CASTLE_POSITION 58
 
 #include "board.h"
 
 #include <stdint.h>
 
 typedef struct {
-    uint64_t *pos_bb;
     char symbol;
     char color;
     int value;
 } Piece;
 
-Piece *get_pieces(void);
+const Piece *get_pieces(void);
 
-int calculate_possible_moves(int position);
+const uint64_t *get_start_bitboards(void);
 
-uint64_t get_full_board(void);
+int get_piece_index(char symbol);
 
-uint64_t find_possible_moves(Square input_square, Piece *piece,
-                             GameState *game_state);
+uint64_t get_full_board(const Position *pos);
 
-Piece *find_piece_by_position(int position);
+uint64_t get_color_board(const Position *pos, char color);
+
+uint64_t find_possible_moves(const Position *pos, Square input_square);
+
+int find_piece_by_position(const Position *pos, int position);
 
 int is_bit_set(uint64_t bb, int position);
 
-Piece *get_piece_bb(char piece);
+void bitboards_to_board(const Position *pos, char board[8][8]);
+
+// Squares attacked by the piece of type piece_index standing on position
+uint64_t find_piece_attacks(int piece_index, int position, uint64_t own_board,
+                            uint64_t full_board);
+
+uint64_t find_attacked_squares(const Position *pos, char color);
+
+// Number of pieces of color attacking or defending each square
+void find_attack_counts(const Position *pos, char color, uint8_t counts[64]);
+
+int find_castle_right(const Position *pos, char color, int from, int to);
+
+int update_castle_rights(const Position *pos, int castle_rights, int from,
+                         int to);
+
+void init_castle_rule(CastleRule *rule, char color, int king_file,
+                      int rook_file, int short_castle);
+
+int setup_chess960(Position *pos, int number);
 
-#endif
\ No newline at end of file
+#endif
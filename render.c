@@ -0,0 +1,383 @@
+#include "render.h"
+
+#include "assets.h"
+#include "board.h"
+#include "pieces.h"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BOARD_PIXELS (8 * SQUARE_SIZE)
+#define MAX_BATCH_VERTICES 4096
+#define MAX_BATCH_INDICES 8192
+#define CIRCLE_SEGMENTS 32
+#define HEATMAP_ALPHA_STEP 45
+#define HEATMAP_MAX_ALPHA 200
+
+// Everything drawn on top of the background goes through one vertex batch
+// textured from the atlas; solid shapes sample its white cell
+struct GeometryBatch {
+    SDL_Vertex vertices[MAX_BATCH_VERTICES];
+    int indices[MAX_BATCH_INDICES];
+    int vertex_count;
+    int index_count;
+};
+
+static const SDL_Color SELECTED_COLOR = {60, 80, 50, 180};
+static const SDL_Color MOVE_COLOR = {60, 80, 50, 180};
+static const SDL_Color PREMOVE_COLOR = {70, 110, 170, 160};
+static const SDL_Color CHECK_COLOR = {220, 50, 50, 180};
+static const SDL_Color PROMOTION_COLOR = {211, 211, 211, 255};
+static const SDL_Color PIECE_COLOR = {255, 255, 255, 255};
+
+static void flush_batch(BoardRenderer *board_renderer)
+{
+    GeometryBatch *batch = board_renderer->batch;
+    if (batch->index_count == 0) {
+        return;
+    }
+    SDL_RenderGeometry(board_renderer->renderer, board_renderer->atlas,
+                       batch->vertices, batch->vertex_count, batch->indices,
+                       batch->index_count);
+    board_renderer->draw_calls++;
+    batch->vertex_count = 0;
+    batch->index_count = 0;
+}
+
+static void reserve_batch(BoardRenderer *board_renderer, int vertices,
+                          int indices)
+{
+    GeometryBatch *batch = board_renderer->batch;
+    if (batch->vertex_count + vertices > MAX_BATCH_VERTICES ||
+        batch->index_count + indices > MAX_BATCH_INDICES) {
+        flush_batch(board_renderer);
+    }
+}
+
+static int add_vertex(GeometryBatch *batch, float x, float y, SDL_Color color,
+                      float u, float v)
+{
+    SDL_Vertex *vertex = &batch->vertices[batch->vertex_count];
+    vertex->position = (SDL_FPoint) {x, y};
+    vertex->color = color;
+    vertex->tex_coord = (SDL_FPoint) {u / ATLAS_WIDTH, v / ATLAS_HEIGHT};
+    return batch->vertex_count++;
+}
+
+static void add_solid_vertex(GeometryBatch *batch, float x, float y,
+                             SDL_Color color)
+{
+    // Sample the middle of the white cell so filtering never picks up a
+    // neighbouring piece
+    SDL_Rect solid = get_solid_atlas_rect();
+    int index = add_vertex(batch, x, y, color, solid.x + solid.w / 2.0f,
+                           solid.y + solid.h / 2.0f);
+    batch->indices[batch->index_count++] = index;
+}
+
+static void add_quad(BoardRenderer *board_renderer, SDL_Rect dst,
+                     SDL_Rect src, SDL_Color color)
+{
+    reserve_batch(board_renderer, 4, 6);
+    GeometryBatch *batch = board_renderer->batch;
+
+    int top_left = add_vertex(batch, dst.x, dst.y, color, src.x, src.y);
+    int top_right = add_vertex(batch, dst.x + dst.w, dst.y, color,
+                               src.x + src.w, src.y);
+    int bottom_left = add_vertex(batch, dst.x, dst.y + dst.h, color, src.x,
+                                 src.y + src.h);
+    int bottom_right = add_vertex(batch, dst.x + dst.w, dst.y + dst.h, color,
+                                  src.x + src.w, src.y + src.h);
+
+    int quad[6] = {top_left,    top_right, bottom_left,
+                   bottom_left, top_right, bottom_right};
+    for (int i = 0; i < 6; i++) {
+        batch->indices[batch->index_count++] = quad[i];
+    }
+}
+
+static void add_triangle(BoardRenderer *board_renderer, float x0, float y0,
+                         float x1, float y1, float x2, float y2,
+                         SDL_Color color)
+{
+    reserve_batch(board_renderer, 3, 3);
+    GeometryBatch *batch = board_renderer->batch;
+    add_solid_vertex(batch, x0, y0, color);
+    add_solid_vertex(batch, x1, y1, color);
+    add_solid_vertex(batch, x2, y2, color);
+}
+
+static void add_circle(BoardRenderer *board_renderer, float center_x,
+                       float center_y, float radius, SDL_Color color)
+{
+    for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+        float start = (float) (2.0 * M_PI * i / CIRCLE_SEGMENTS);
+        float end = (float) (2.0 * M_PI * (i + 1) / CIRCLE_SEGMENTS);
+        add_triangle(board_renderer, center_x, center_y,
+                     center_x + radius * cosf(start),
+                     center_y + radius * sinf(start),
+                     center_x + radius * cosf(end),
+                     center_y + radius * sinf(end), color);
+    }
+}
+
+static void add_piece(BoardRenderer *board_renderer, char symbol, int x,
+                      int y)
+{
+    SDL_Rect dst = {x, y, SQUARE_SIZE, SQUARE_SIZE};
+    add_quad(board_renderer, dst, get_piece_atlas_rect(symbol), PIECE_COLOR);
+}
+
+static void begin_frame(BoardRenderer *board_renderer)
+{
+    board_renderer->frame_start = SDL_GetPerformanceCounter();
+    board_renderer->draw_calls = 0;
+    SDL_RenderCopy(board_renderer->renderer, board_renderer->background, NULL,
+                   NULL);
+    board_renderer->draw_calls++;
+}
+
+static void end_frame(BoardRenderer *board_renderer)
+{
+    flush_batch(board_renderer);
+    SDL_RenderPresent(board_renderer->renderer);
+    board_renderer->frame_ms =
+        (double) (SDL_GetPerformanceCounter() - board_renderer->frame_start) *
+        1000.0 /
+        (double) SDL_GetPerformanceFrequency();
+}
+
+int init_board_renderer(BoardRenderer *board_renderer, SDL_Renderer *renderer,
+                        SDL_Texture *atlas)
+{
+    board_renderer->renderer = renderer;
+    board_renderer->atlas = atlas;
+    board_renderer->draw_calls = 0;
+    board_renderer->frame_ms = 0.0;
+
+    board_renderer->batch = malloc(sizeof(GeometryBatch));
+    if (!board_renderer->batch) {
+        printf("Failed to allocate geometry batch\n");
+        return 1;
+    }
+    board_renderer->batch->vertex_count = 0;
+    board_renderer->batch->index_count = 0;
+
+    // The squares never change, draw them once into a texture
+    board_renderer->background =
+        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                          SDL_TEXTUREACCESS_TARGET, BOARD_PIXELS, BOARD_PIXELS);
+    if (!board_renderer->background) {
+        printf("Failed to create board texture: %s\n", SDL_GetError());
+        free(board_renderer->batch);
+        return 1;
+    }
+    SDL_SetRenderTarget(renderer, board_renderer->background);
+    for (int row = 0; row < 8; row++) {
+        for (int file = 0; file < 8; file++) {
+            SDL_Rect rect = {file * SQUARE_SIZE, (7 - row) * SQUARE_SIZE,
+                             SQUARE_SIZE, SQUARE_SIZE};
+            if ((file + row) % 2 == 1)
+                SDL_SetRenderDrawColor(renderer, 240, 217, 181, 255);
+            else
+                SDL_SetRenderDrawColor(renderer, 181, 136, 99, 255);
+            SDL_RenderFillRect(renderer, &rect);
+        }
+    }
+    SDL_SetRenderTarget(renderer, NULL);
+
+    // One texel per square, only rewritten when a move has been played
+    board_renderer->heatmap =
+        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                          SDL_TEXTUREACCESS_STREAMING, 8, 8);
+    if (!board_renderer->heatmap) {
+        printf("Failed to create heatmap texture: %s\n", SDL_GetError());
+        SDL_DestroyTexture(board_renderer->background);
+        free(board_renderer->batch);
+        return 1;
+    }
+    SDL_SetTextureBlendMode(board_renderer->heatmap, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(board_renderer->heatmap, SDL_ScaleModeNearest);
+    board_renderer->show_heatmap = 0;
+    board_renderer->heatmap_move = -1;
+    return 0;
+}
+
+void destroy_board_renderer(BoardRenderer *board_renderer)
+{
+    SDL_DestroyTexture(board_renderer->background);
+    SDL_DestroyTexture(board_renderer->heatmap);
+    free(board_renderer->batch);
+    board_renderer->background = NULL;
+    board_renderer->heatmap = NULL;
+    board_renderer->batch = NULL;
+}
+
+void toggle_heatmap(BoardRenderer *board_renderer)
+{
+    board_renderer->show_heatmap = !board_renderer->show_heatmap;
+    board_renderer->heatmap_move = -1;
+}
+
+// Blue for squares white controls, red for black, more opaque the more
+// pieces bear on the square
+static void update_heatmap(BoardRenderer *board_renderer, const Position *pos)
+{
+    uint8_t white_counts[64];
+    uint8_t black_counts[64];
+    void *pixels;
+    int pitch;
+
+    find_attack_counts(pos, 'w', white_counts);
+    find_attack_counts(pos, 'b', black_counts);
+    if (SDL_LockTexture(board_renderer->heatmap, NULL, &pixels, &pitch) != 0) {
+        printf("Failed to lock heatmap texture: %s\n", SDL_GetError());
+        return;
+    }
+    for (int row = 0; row < 8; row++) {
+        for (int file = 0; file < 8; file++) {
+            int position = get_position(file, row);
+            int white = white_counts[position];
+            int black = black_counts[position];
+            int total = white + black;
+            Uint8 *pixel = (Uint8 *) pixels + (7 - row) * pitch + file * 4;
+
+            pixel[0] = total ? 255 * black / total : 0;
+            pixel[1] = 40;
+            pixel[2] = total ? 255 * white / total : 0;
+            pixel[3] = total * HEATMAP_ALPHA_STEP > HEATMAP_MAX_ALPHA
+                           ? HEATMAP_MAX_ALPHA
+                           : total * HEATMAP_ALPHA_STEP;
+        }
+    }
+    SDL_UnlockTexture(board_renderer->heatmap);
+}
+
+void draw_possible_moves(BoardRenderer *board_renderer, char board[8][8],
+                         uint64_t pos_mov)
+{
+    while (pos_mov) {
+        int sq = get_lowest_bit_index(pos_mov);
+        int rank = sq / 8;
+        int file = sq % 8;
+        float x = file * SQUARE_SIZE;
+        float y = (7 - rank) * SQUARE_SIZE;
+        float size = SQUARE_SIZE;
+
+        // Check if square has a piece (capture move)
+        if (board[rank][file] != 0) {
+            // Triangles in the corners, legs along the square edges
+            float corner = SQUARE_SIZE / 5;
+            add_triangle(board_renderer, x, y, x + corner, y, x, y + corner,
+                         MOVE_COLOR);
+            add_triangle(board_renderer, x + size, y, x + size - corner, y,
+                         x + size, y + corner, MOVE_COLOR);
+            add_triangle(board_renderer, x, y + size, x + corner, y + size, x,
+                         y + size - corner, MOVE_COLOR);
+            add_triangle(board_renderer, x + size, y + size,
+                         x + size - corner, y + size, x + size,
+                         y + size - corner, MOVE_COLOR);
+        } else {
+            // Circle in center for empty squares
+            add_circle(board_renderer, x + size / 2, y + size / 2,
+                       SQUARE_SIZE / 6, MOVE_COLOR);
+        }
+        pos_mov &= pos_mov - 1;
+    }
+}
+
+void add_board_geometry(BoardRenderer *board_renderer, char board[8][8],
+                        Square sel_square, uint64_t pos_mov,
+                        uint64_t premove_bb, GameState *game_state)
+{
+    while (premove_bb) {
+        int position = get_lowest_bit_index(premove_bb);
+        SDL_Rect rect = {(position % 8) * SQUARE_SIZE,
+                         (7 - position / 8) * SQUARE_SIZE, SQUARE_SIZE,
+                         SQUARE_SIZE};
+        add_quad(board_renderer, rect, get_solid_atlas_rect(), PREMOVE_COLOR);
+        premove_bb &= premove_bb - 1;
+    }
+
+    if (sel_square.file >= 0 && sel_square.row >= 0) {
+        SDL_Rect rect = {sel_square.file * SQUARE_SIZE,
+                         (7 - sel_square.row) * SQUARE_SIZE, SQUARE_SIZE,
+                         SQUARE_SIZE};
+        add_quad(board_renderer, rect, get_solid_atlas_rect(),
+                 SELECTED_COLOR);
+    }
+
+    for (int row = 0; row < 8; row++) {
+        for (int file = 0; file < 8; file++) {
+            if (board[row][file] != 0) {
+                add_piece(board_renderer, board[row][file],
+                          file * SQUARE_SIZE, (7 - row) * SQUARE_SIZE);
+            }
+        }
+    }
+    draw_possible_moves(board_renderer, board, pos_mov);
+
+    if (game_state->is_check) {
+        char color_moving = color_to_move(&game_state->pos);
+        int king_index =
+            color_moving == 'w' ? WHITE_KING_INDEX : BLACK_KING_INDEX;
+        int king_position =
+            get_lowest_bit_index(game_state->pos.bitboards[king_index]);
+        Square king_square = square_from_position(king_position);
+
+        add_circle(board_renderer,
+                   king_square.file * SQUARE_SIZE + SQUARE_SIZE / 2,
+                   (7 - king_square.row) * SQUARE_SIZE + SQUARE_SIZE / 2,
+                   SQUARE_SIZE / 2, CHECK_COLOR);
+    }
+}
+
+void render_board(BoardRenderer *board_renderer, char board[8][8],
+                  Square sel_square, uint64_t pos_mov, uint64_t premove_bb,
+                  int render_bool, GameState *game_state)
+{
+    begin_frame(board_renderer);
+    if (board_renderer->show_heatmap) {
+        if (board_renderer->heatmap_move != game_state->moves_played) {
+            update_heatmap(board_renderer, &game_state->pos);
+            board_renderer->heatmap_move = game_state->moves_played;
+        }
+        SDL_RenderCopy(board_renderer->renderer, board_renderer->heatmap, NULL,
+                       NULL);
+        board_renderer->draw_calls++;
+    }
+    add_board_geometry(board_renderer, board, sel_square, pos_mov, premove_bb,
+                       game_state);
+    if (render_bool) {
+        end_frame(board_renderer);
+    }
+}
+
+void render_promotion_squares(BoardRenderer *board_renderer,
+                              Square output_square, int direction,
+                              char promotion_pieces[], GameState *game_state)
+{
+    char board[8][8];
+    Square fake_square = {-1, -1};
+    bitboards_to_board(&game_state->pos, board);
+    uint64_t pos_mov = (uint64_t) 0;
+    uint64_t premove_bb = (uint64_t) 0;
+    int render_bool = 0;
+
+    render_board(board_renderer, board, fake_square, pos_mov, premove_bb,
+                 render_bool, game_state);
+
+    for (int i = 0; i < 4; i++) {
+        int row = (7 - output_square.row + (i * direction));
+        int file = output_square.file;
+        add_circle(board_renderer, file * SQUARE_SIZE + SQUARE_SIZE / 2,
+                   row * SQUARE_SIZE + SQUARE_SIZE / 2, SQUARE_SIZE / 2,
+                   PROMOTION_COLOR);
+        add_piece(board_renderer, promotion_pieces[i], file * SQUARE_SIZE,
+                  row * SQUARE_SIZE);
+    }
+    end_frame(board_renderer);
+}
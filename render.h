@@ -0,0 +1,42 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "board.h"
+#include "pieces.h"
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+typedef struct GeometryBatch GeometryBatch;
+
+typedef struct {
+    SDL_Renderer *renderer;
+    SDL_Texture *atlas;
+    SDL_Texture *background;
+    GeometryBatch *batch;
+    // 8x8 attack heatmap, stretched over the board when enabled
+    SDL_Texture *heatmap;
+    int show_heatmap;
+    int heatmap_move; // moves_played the heatmap was built for
+    // Statistics of the last presented frame, shown in the window title
+    int draw_calls;
+    double frame_ms;
+    Uint64 frame_start;
+} BoardRenderer;
+
+int init_board_renderer(BoardRenderer *board_renderer, SDL_Renderer *renderer,
+                        SDL_Texture *atlas);
+
+void destroy_board_renderer(BoardRenderer *board_renderer);
+
+void toggle_heatmap(BoardRenderer *board_renderer);
+
+void render_board(BoardRenderer *board_renderer, char board[8][8],
+                  Square sel_square, uint64_t pos_mov, uint64_t premove_bb,
+                  int render_bool, GameState *game_state);
+
+void render_promotion_squares(BoardRenderer *board_renderer,
+                              Square output_square, int direction,
+                              char promotion_pieces[], GameState *game_state);
+
+#endif
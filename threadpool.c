@@ -0,0 +1,343 @@
+#include "threadpool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEQUE_CAPACITY 4096
+#define STEAL_ROUNDS_BEFORE_SLEEP 64
+
+// Chase-Lev deque with a fixed capacity (Le, Pop, Cohen and Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models", 2013).
+// Aligned so that two deques never share a cache line.
+typedef struct {
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    _Atomic(Task *) buffer[DEQUE_CAPACITY];
+} TaskDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+    pthread_t thread;
+} Worker;
+
+struct ThreadPool {
+    int threads;
+    TaskDeque *deques; // Index 0 belongs to the creating thread
+    Worker workers[MAX_POOL_THREADS];
+    atomic_int stopping;
+    atomic_int sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+// Deque of the calling thread: 0 outside the pool, its worker index inside
+static _Thread_local int current_deque = 0;
+static _Thread_local uint64_t steal_state = 0;
+
+static int push_task(TaskDeque *deque, Task *task)
+{
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= DEQUE_CAPACITY) {
+        return 0;
+    }
+    atomic_store_explicit(&deque->buffer[bottom % DEQUE_CAPACITY], task,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 1;
+}
+
+static Task *take_task(TaskDeque *deque)
+{
+    long bottom =
+        atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&deque->buffer[bottom % DEQUE_CAPACITY],
+                                      memory_order_relaxed);
+    if (top == bottom) {
+        // Last task, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1, memory_order_seq_cst,
+                memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+    }
+    return task;
+}
+
+static Task *steal_task(TaskDeque *deque)
+{
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&deque->buffer[top % DEQUE_CAPACITY],
+                                      memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static void run_task(Task *task)
+{
+    TaskGroup *group = task->group;
+    if (!atomic_load_explicit(&group->cancelled, memory_order_relaxed)) {
+        task->function(task->arg);
+    }
+    // The task may be freed by the waiter as soon as pending drops
+    atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel);
+}
+
+static Task *find_task(ThreadPool *pool)
+{
+    Task *task = take_task(&pool->deques[current_deque]);
+    if (task) {
+        return task;
+    }
+
+    // Start at a random victim so that thieves spread out
+    if (steal_state == 0) {
+        steal_state = (uint64_t) (current_deque + 1) * 0x9E3779B97F4A7C15ULL;
+    }
+    steal_state ^= steal_state << 13;
+    steal_state ^= steal_state >> 7;
+    steal_state ^= steal_state << 17;
+    int start = (int) (steal_state % pool->threads);
+    for (int i = 0; i < pool->threads; i++) {
+        int victim = (start + i) % pool->threads;
+        if (victim == current_deque) {
+            continue;
+        }
+        task = steal_task(&pool->deques[victim]);
+        if (task) {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static int has_queued_tasks(ThreadPool *pool)
+{
+    for (int i = 0; i < pool->threads; i++) {
+        TaskDeque *deque = &pool->deques[i];
+        if (atomic_load(&deque->top) < atomic_load(&deque->bottom)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    int idle_rounds = 0;
+    current_deque = worker->index;
+
+    while (!atomic_load_explicit(&pool->stopping, memory_order_acquire)) {
+        Task *task = find_task(pool);
+        if (task) {
+            run_task(task);
+            idle_rounds = 0;
+            continue;
+        }
+        if (++idle_rounds < STEAL_ROUNDS_BEFORE_SLEEP) {
+            sched_yield();
+            continue;
+        }
+
+        // Announce the sleep before the last look, submit_task() checks
+        // sleeping after publishing its task so one of the two sees the other
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        if (!has_queued_tasks(pool) && !atomic_load(&pool->stopping)) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        pthread_mutex_unlock(&pool->lock);
+        idle_rounds = 0;
+    }
+    return NULL;
+}
+
+ThreadPool *create_thread_pool(int threads)
+{
+    if (threads < 1 || threads > MAX_POOL_THREADS) {
+        printf("Thread pool size must be between 1 and %d\n",
+               MAX_POOL_THREADS);
+        return NULL;
+    }
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->deques = aligned_alloc(64, threads * sizeof(TaskDeque));
+    if (!pool->deques) {
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < threads; i++) {
+        atomic_init(&pool->deques[i].top, 0);
+        atomic_init(&pool->deques[i].bottom, 0);
+    }
+    pool->threads = threads;
+    atomic_init(&pool->stopping, 0);
+    atomic_init(&pool->sleeping, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    current_deque = 0;
+
+    for (int i = 1; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main,
+                           &pool->workers[i]) != 0) {
+            printf("Failed to start pool thread %d\n", i);
+            pool->threads = i;
+            destroy_thread_pool(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void destroy_thread_pool(ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stopping, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->deques);
+    free(pool);
+}
+
+int get_pool_threads(const ThreadPool *pool)
+{
+    return pool->threads;
+}
+
+void init_task_group(TaskGroup *group)
+{
+    atomic_init(&group->pending, 0);
+    atomic_init(&group->cancelled, 0);
+}
+
+void submit_task(ThreadPool *pool, Task *task, TaskFunction function,
+                 void *arg, TaskGroup *group)
+{
+    task->function = function;
+    task->arg = arg;
+    task->group = group;
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+
+    if (!push_task(&pool->deques[current_deque], task)) {
+        run_task(task);
+        return;
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->sleeping, memory_order_relaxed)) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void wait_task_group(ThreadPool *pool, TaskGroup *group)
+{
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        // Help instead of blocking, this also keeps nested waits inside
+        // tasks from deadlocking the pool
+        Task *task = find_task(pool);
+        if (task) {
+            run_task(task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+void cancel_task_group(TaskGroup *group)
+{
+    atomic_store_explicit(&group->cancelled, 1, memory_order_relaxed);
+}
+
+int is_task_group_cancelled(TaskGroup *group)
+{
+    return atomic_load_explicit(&group->cancelled, memory_order_relaxed);
+}
+
+typedef struct {
+    Task task;
+    int begin;
+    int end;
+    void (*body)(int index, void *arg);
+    void *arg;
+} ForChunk;
+
+static void run_for_chunk(void *arg)
+{
+    ForChunk *chunk = arg;
+    for (int i = chunk->begin; i < chunk->end; i++) {
+        chunk->body(i, chunk->arg);
+    }
+}
+
+int parallel_for(ThreadPool *pool, int count, int grain,
+                 void (*body)(int index, void *arg), void *arg)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    int chunk_count = (count + grain - 1) / grain;
+    ForChunk *chunks = malloc(chunk_count * sizeof(ForChunk));
+    if (!chunks) {
+        printf("Failed to allocate %d parallel_for chunks\n", chunk_count);
+        return -1;
+    }
+
+    TaskGroup group;
+    init_task_group(&group);
+    for (int i = 0; i < chunk_count; i++) {
+        ForChunk *chunk = &chunks[i];
+        int remaining = count - i * grain;
+        chunk->begin = i * grain;
+        chunk->end = chunk->begin + (remaining < grain ? remaining : grain);
+        chunk->body = body;
+        chunk->arg = arg;
+        submit_task(pool, &chunk->task, run_for_chunk, chunk, &group);
+    }
+    wait_task_group(pool, &group);
+    free(chunks);
+    return 0;
+}
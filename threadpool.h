@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdatomic.h>
+
+#define MAX_POOL_THREADS 64
+
+// Work-stealing thread pool. Every worker owns a Chase-Lev deque: it pushes
+// and pops its own tasks at the bottom while idle workers steal from the
+// top. Tasks may be submitted by the thread that created the pool and by
+// tasks running inside it.
+
+typedef void (*TaskFunction)(void *arg);
+
+typedef struct {
+    atomic_int pending;
+    atomic_int cancelled;
+} TaskGroup;
+
+// Caller-owned, must stay alive until the group has been waited on. The pool
+// never allocates per task.
+typedef struct {
+    TaskFunction function;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+typedef struct ThreadPool ThreadPool;
+
+// threads counts the workers plus the creating thread, which runs tasks
+// while it waits. Returns NULL on failure.
+ThreadPool *create_thread_pool(int threads);
+
+void destroy_thread_pool(ThreadPool *pool);
+
+int get_pool_threads(const ThreadPool *pool);
+
+void init_task_group(TaskGroup *group);
+
+// Runs the task inline when the submitting thread's deque is full
+void submit_task(ThreadPool *pool, Task *task, TaskFunction function,
+                 void *arg, TaskGroup *group);
+
+// Runs queued tasks until every task of the group has finished
+void wait_task_group(ThreadPool *pool, TaskGroup *group);
+
+// Tasks of the group that have not started are skipped, running tasks can
+// poll is_task_group_cancelled() to stop early
+void cancel_task_group(TaskGroup *group);
+
+int is_task_group_cancelled(TaskGroup *group);
+
+// Calls body(index, arg) for every index in [0, count), grain indices per
+// task, and returns when all of them are done
+int parallel_for(ThreadPool *pool, int count, int grain,
+                 void (*body)(int index, void *arg), void *arg);
+
+#endif